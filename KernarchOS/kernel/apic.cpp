@@ -0,0 +1,132 @@
+#include "apic.h"
+#include "cpu.h"
+#include "pit.h"
+#include "paging.h"
+#include "logger.h"
+
+static volatile uint32_t* apic_base = nullptr;
+
+uint32_t apic_read(uint32_t reg) {
+    return apic_base[reg / 4];
+}
+
+void apic_write(uint32_t reg, uint32_t value) {
+    apic_base[reg / 4] = value;
+}
+
+void apic_eoi() {
+    apic_write(APIC_REG_EOI, 0);
+}
+
+uint32_t apic_id() {
+    return apic_read(APIC_REG_ID) >> 24;
+}
+
+bool apic_available() {
+    return apic_base != nullptr;
+}
+
+static void apic_spurious_handler(interrupt_frame* frame) {
+    // Spurious interrupts must not be acknowledged
+}
+
+bool apic_init() {
+    if (!cpu_has(CPUID_EDX_APIC) || !cpu_has(CPUID_EDX_MSR)) {
+        Logger::log(LogLevel::WARNING, "No local APIC present");
+        return false;
+    }
+
+    uint64_t base_msr = rdmsr(IA32_APIC_BASE_MSR);
+    uint32_t base = (uint32_t)base_msr & 0xFFFFF000;
+    wrmsr(IA32_APIC_BASE_MSR, base_msr | APIC_BASE_ENABLE);
+
+    // Registers are MMIO, they must not be cached
+    map_mmio_page(base);
+    apic_base = (volatile uint32_t*)base;
+
+    // Keep the 8259 reachable through LINT0 (virtual wire mode)
+    apic_write(APIC_REG_LVT_LINT0, 0x700);          // ExtINT
+    apic_write(APIC_REG_LVT_LINT1, 0x400);          // NMI
+    apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED);
+    apic_write(APIC_REG_TPR, 0);
+    apic_write(APIC_REG_SVR, 0x100 | INT_APIC_SPURIOUS);  // Software enable
+
+    register_interrupt_handler(INT_APIC_SPURIOUS, apic_spurious_handler);
+
+    Logger::log(LogLevel::INFO, "Local APIC %d enabled at 0x%x", apic_id(), base);
+    return true;
+}
+
+void apic_init_cpu() {
+    wrmsr(IA32_APIC_BASE_MSR, rdmsr(IA32_APIC_BASE_MSR) | APIC_BASE_ENABLE);
+
+    apic_write(APIC_REG_LVT_LINT0, APIC_LVT_MASKED);
+    apic_write(APIC_REG_LVT_LINT1, APIC_LVT_MASKED);
+    apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED);
+    apic_write(APIC_REG_TPR, 0);
+    apic_write(APIC_REG_SVR, 0x100 | INT_APIC_SPURIOUS);
+}
+
+static void apic_wait_icr() {
+    while (apic_read(APIC_REG_ICR_LOW) & APIC_ICR_PENDING) {
+        asm volatile("pause");
+    }
+}
+
+void apic_send_ipi(uint32_t apic_id, uint32_t icr) {
+    apic_wait_icr();
+    apic_write(APIC_REG_ICR_HIGH, apic_id << 24);
+    apic_write(APIC_REG_ICR_LOW, icr); // Writing the low half sends it
+    apic_wait_icr();
+}
+
+void apic_broadcast_ipi(uint32_t icr) {
+    apic_wait_icr();
+    apic_write(APIC_REG_ICR_HIGH, 0);
+    apic_write(APIC_REG_ICR_LOW, icr | APIC_ICR_ALL_BUT_SELF);
+    apic_wait_icr();
+}
+
+// Counts APIC timer ticks (and TSC cycles) elapsed over a PIT measured interval
+uint32_t apic_timer_calibrate(uint32_t ms, uint64_t* tsc_delta) {
+    apic_write(APIC_REG_TIMER_DIVIDE, APIC_DIVIDE_16);
+    apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED);
+
+    pit_calibration_start(ms);
+    uint64_t tsc_start = rdtsc();
+    apic_write(APIC_REG_TIMER_INIT, 0xFFFFFFFF);
+
+    while (!pit_calibration_done()) {
+        asm volatile("pause");
+    }
+
+    uint32_t remaining = apic_read(APIC_REG_TIMER_CURRENT);
+    uint64_t tsc_end = rdtsc();
+    apic_write(APIC_REG_TIMER_INIT, 0);
+
+    if (tsc_delta) *tsc_delta = tsc_end - tsc_start;
+    return 0xFFFFFFFF - remaining;
+}
+
+void apic_timer_set_mode(uint32_t mode) {
+    apic_write(APIC_REG_TIMER_DIVIDE, APIC_DIVIDE_16);
+    apic_write(APIC_REG_LVT_TIMER, INT_APIC_TIMER | mode);
+}
+
+// The arming functions expect apic_timer_set_mode to have selected the mode
+void apic_timer_periodic(uint32_t count) {
+    apic_write(APIC_REG_TIMER_INIT, count);
+}
+
+void apic_timer_oneshot(uint32_t count) {
+    apic_write(APIC_REG_TIMER_INIT, count ? count : 1);
+}
+
+void apic_timer_deadline(uint64_t tsc) {
+    wrmsr(IA32_TSC_DEADLINE_MSR, tsc);
+}
+
+void apic_timer_stop() {
+    apic_write(APIC_REG_TIMER_INIT, 0);
+    if (cpu_has_ecx(CPUID_ECX_TSC_DEADLINE)) wrmsr(IA32_TSC_DEADLINE_MSR, 0);
+}
@@ -0,0 +1,60 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include "types.h"
+#include "isr.h"
+
+#define IA32_APIC_BASE_MSR      0x1B
+#define IA32_TSC_DEADLINE_MSR   0x6E0
+#define APIC_BASE_ENABLE        (1 << 11)
+
+// Local APIC register offsets
+#define APIC_REG_ID             0x020
+#define APIC_REG_TPR            0x080
+#define APIC_REG_EOI            0x0B0
+#define APIC_REG_SVR            0x0F0
+#define APIC_REG_ICR_LOW        0x300
+#define APIC_REG_ICR_HIGH       0x310
+#define APIC_REG_LVT_TIMER      0x320
+#define APIC_REG_LVT_LINT0      0x350
+#define APIC_REG_LVT_LINT1      0x360
+#define APIC_REG_TIMER_INIT     0x380
+#define APIC_REG_TIMER_CURRENT  0x390
+#define APIC_REG_TIMER_DIVIDE   0x3E0
+
+#define APIC_LVT_MASKED         (1 << 16)
+#define APIC_TIMER_ONESHOT      (0 << 17)
+#define APIC_TIMER_PERIODIC     (1 << 17)
+#define APIC_TIMER_TSC_DEADLINE (2 << 17)
+#define APIC_DIVIDE_16          0x3
+
+// Interrupt command register fields
+#define APIC_ICR_FIXED          (0 << 8)
+#define APIC_ICR_INIT           (5 << 8)
+#define APIC_ICR_STARTUP        (6 << 8)
+#define APIC_ICR_PENDING        (1 << 12)
+#define APIC_ICR_ASSERT         (1 << 14)
+#define APIC_ICR_LEVEL          (1 << 15)
+#define APIC_ICR_ALL_BUT_SELF   (3 << 18)
+
+bool apic_init();
+bool apic_available();
+uint32_t apic_read(uint32_t reg);
+void apic_write(uint32_t reg, uint32_t value);
+void apic_eoi();
+uint32_t apic_id();
+
+// Application processors: their APIC, with the 8259 left to the boot CPU
+void apic_init_cpu();
+void apic_send_ipi(uint32_t apic_id, uint32_t icr);
+void apic_broadcast_ipi(uint32_t icr);
+
+// Timer programming, counts are in divided bus clocks
+uint32_t apic_timer_calibrate(uint32_t ms, uint64_t* tsc_delta);
+void apic_timer_set_mode(uint32_t mode);
+void apic_timer_periodic(uint32_t count);
+void apic_timer_oneshot(uint32_t count);
+void apic_timer_deadline(uint64_t tsc);
+void apic_timer_stop();
+
+#endif // APIC_H
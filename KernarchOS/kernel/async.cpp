@@ -0,0 +1,94 @@
+#include "async.h"
+#include "thread.h"
+#include "keyboard.h"
+#include "memory.h"
+#include "logger.h"
+
+WaitQueue Executor::waiters;
+AsyncNode* Executor::head;
+AsyncNode* Executor::tail;
+volatile uint32_t Executor::live_count;
+uint32_t Executor::resume_count;
+volatile uint32_t Executor::frame_total;
+uint32_t Executor::frame_max;
+
+void Executor::start() {
+    Thread* thread = ThreadManager::create_thread(run, nullptr, false);
+    if (!thread) {
+        Logger::log(LogLevel::ERROR, "Failed to create the executor thread");
+        return;
+    }
+    wake_process(thread);
+}
+
+bool Executor::spawn(Task<void> task) {
+    if (!task.valid()) {
+        Logger::log(LogLevel::ERROR, "Failed to spawn a task: Out of memory");
+        return false;
+    }
+
+    Task<void>::Handle handle = task.release();
+    TaskPromise<void>& promise = handle.promise();
+    promise.detached = true;
+    promise.node.handle = handle;
+    __atomic_add_fetch(&live_count, 1, __ATOMIC_RELAXED);
+    schedule(&promise.node);
+    return true;
+}
+
+void Executor::schedule(AsyncNode* node) {
+    uint32_t flags = waiters.lock_irqsave();
+    node->next = nullptr;
+    if (tail) tail->next = node;
+    else head = node;
+    tail = node;
+    waiters.wake_one_locked();
+    waiters.unlock_irqrestore(flags);
+}
+
+void* Executor::allocate_frame(size_t size) {
+    void* frame = kmalloc(size);
+    if (!frame) return nullptr;
+
+    uint32_t total = __atomic_add_fetch(&frame_total, size, __ATOMIC_RELAXED);
+    if (total > frame_max) frame_max = total;
+    return frame;
+}
+
+void Executor::free_frame(void* frame, size_t size) {
+    __atomic_sub_fetch(&frame_total, size, __ATOMIC_RELAXED);
+    kfree(frame);
+}
+
+void Executor::finished() {
+    __atomic_sub_fetch(&live_count, 1, __ATOMIC_RELAXED);
+}
+
+// Resumes everything that became ready since the last pass, in order.
+// Coroutines resumed here that suspend again go to the back of the list.
+void Executor::run() {
+    while (true) {
+        AsyncNode* batch = nullptr;
+        waiters.wait_until([&] {
+            batch = head;
+            head = tail = nullptr;
+            return batch != nullptr;
+        });
+
+        while (batch) {
+            // The node lives in the coroutine's frame, read it before resuming
+            AsyncNode* next = batch->next;
+            batch->handle.resume();
+            resume_count++;
+            batch = next;
+        }
+    }
+}
+
+Task<char> async_getchar() {
+    char key = 0;
+    while (!Keyboard::read(&key, 1, false)) {
+        co_await AsyncWait(Keyboard::input_queue(), [] { return Keyboard::has_char(); });
+    }
+    co_return key;
+}
@@ -0,0 +1,250 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include "types.h"
+#include "coroutine.h"
+#include "waitqueue.h"
+#include "workqueue.h"
+
+// Stackless kernel activities: coroutines resumed by one executor
+// thread. A suspended coroutine costs only its frame, allocated when it
+// is called and freed when it finishes, so thousands of pending
+// operations do not need thousands of thread stacks.
+//
+//     Task<uint32_t> child() { co_await Executor::sleep(10); co_return 1; }
+//     Task<> activity() { uint32_t n = co_await child(); ... }
+//     Executor::spawn(activity());
+//
+// Every awaitable below resumes its coroutine on the executor thread,
+// whoever completes it. Coroutines must not block the thread itself, a
+// sys_sleep or a blocking read stalls every other coroutine.
+
+// A suspended coroutine waiting for the executor, usually embedded in
+// the awaiter that suspended it
+struct AsyncNode {
+    std::coroutine_handle<> handle;
+    AsyncNode* next;
+};
+
+template<typename T = void>
+class Task;
+
+class Executor {
+public:
+    // Starts the executor thread; coroutines spawned before then wait for it
+    static void start();
+
+    // Runs a task on the executor until it finishes, then frees its frame
+    static bool spawn(Task<void> task);
+
+    // Resumes node's coroutine on the executor, safe from interrupt handlers
+    static void schedule(AsyncNode* node);
+
+    // co_await Executor::yield() lets the other ready coroutines run first
+    struct YieldAwaiter {
+        AsyncNode node;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            node.handle = handle;
+            schedule(&node);
+        }
+        void await_resume() const noexcept {}
+    };
+    static YieldAwaiter yield() { return {}; }
+
+    // co_await Executor::sleep(ms), through delayed work on the workqueue
+    struct SleepAwaiter {
+        uint32_t milliseconds;
+        AsyncNode node;
+        Work work;
+
+        bool await_ready() const noexcept { return milliseconds == 0; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            node.handle = handle;
+            WorkQueue::init(&work, expired, this);
+            WorkQueue::queue_delayed(&work, milliseconds);
+        }
+        void await_resume() const noexcept {}
+
+        static void expired(Work* work) { schedule(&((SleepAwaiter*)work->context)->node); }
+    };
+    static SleepAwaiter sleep(uint32_t milliseconds) { return { milliseconds, {}, {} }; }
+
+    // Spawned tasks not yet finished
+    static uint32_t live() { return live_count; }
+    static uint32_t resumes() { return resume_count; }
+    // Bytes in coroutine frames right now, and the most there ever were
+    static uint32_t frame_bytes() { return frame_total; }
+    static uint32_t frame_peak() { return frame_max; }
+
+    // From the task promise
+    static void* allocate_frame(size_t size);
+    static void free_frame(void* frame, size_t size);
+    static void finished();
+
+private:
+    static void run();
+
+    static WaitQueue waiters;           // Its lock guards the ready list
+    static AsyncNode* head;
+    static AsyncNode* tail;
+    static volatile uint32_t live_count;
+    static uint32_t resume_count;
+    static volatile uint32_t frame_total;
+    static uint32_t frame_max;
+};
+
+// co_await AsyncWait(queue, ready) resumes once ready() holds. ready is
+// evaluated under the queue lock, when awaited and on every wake, like
+// WaitQueue::wait_until, so a wake in between is never lost.
+template<typename Cond>
+class AsyncWait {
+public:
+    AsyncWait(WaitQueue* queue, Cond ready) : queue(queue), ready(ready) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        node.handle = handle;
+        callback.func = woken;
+        callback.context = this;
+
+        uint32_t flags = queue->lock_irqsave();
+        bool wait = !ready();
+        if (wait) queue->add_callback_locked(&callback);
+        queue->unlock_irqrestore(flags);
+        return wait;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    // Queue lock held; passes the wake on while ready() is still false
+    static bool woken(WaitCallback* callback) {
+        AsyncWait* self = (AsyncWait*)callback->context;
+        if (!self->ready()) return false;
+        Executor::schedule(&self->node);
+        return true;
+    }
+
+    WaitQueue* queue;
+    Cond ready;
+    WaitCallback callback;
+    AsyncNode node;
+};
+
+// Shared by every task promise. Tasks start suspended: awaiting one, or
+// spawning it, starts it, and when it finishes it transfers straight
+// back to its awaiter.
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;   // Awaiting coroutine
+    AsyncNode node;                          // Spawned: first resume on the executor
+    bool detached = false;                   // Spawned: frees its own frame at the end
+
+    // Frames come from the kernel heap; nullptr makes the call return an empty task
+    static void* operator new(size_t size) noexcept { return Executor::allocate_frame(size); }
+    static void operator delete(void* frame, size_t size) noexcept { Executor::free_frame(frame, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            TaskPromiseBase& promise = handle.promise();
+            if (promise.continuation) return promise.continuation;
+            if (promise.detached) {
+                handle.destroy();
+                Executor::finished();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() {}
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    T value;
+
+    Task<T> get_return_object();
+    static Task<T> get_return_object_on_allocation_failure();
+    void return_value(T result) { value = result; }
+    T result() { return value; }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    static Task<void> get_return_object_on_allocation_failure();
+    void return_void() {}
+    void result() {}
+};
+
+// A coroutine returning T. Owns its frame until it is awaited or
+// spawned; empty if the frame could not be allocated, awaiting an empty
+// task gives T().
+template<typename T>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle) : handle(handle) {}
+    Task(Task&& other) : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    ~Task() { if (handle) handle.destroy(); }
+
+    bool valid() const { return (bool)handle; }
+
+    // Hands the frame over, to Executor::spawn
+    Handle release() {
+        Handle released = handle;
+        handle = nullptr;
+        return released;
+    }
+
+    bool await_ready() const noexcept { return !handle; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        handle.promise().continuation = awaiter;
+        return handle;
+    }
+
+    T await_resume() {
+        if (!handle) return T();
+        return handle.promise().result();
+    }
+
+private:
+    Handle handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object_on_allocation_failure() {
+    return Task<T>(nullptr);
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object_on_allocation_failure() {
+    return Task<void>(nullptr);
+}
+
+// The next key from the keyboard, without blocking the executor thread
+Task<char> async_getchar();
+
+#endif // ASYNC_H
@@ -0,0 +1,47 @@
+#include "bench.h"
+#include "cpu.h"
+#include "math64.h"
+#include "interrupts.h"
+#include "thread.h"
+
+volatile uint32_t Bench::workers = 0;
+volatile uint32_t Bench::ready = 0;
+volatile uint32_t Bench::running = 0;
+volatile uint32_t Bench::loop_count = 0;
+volatile uint64_t Bench::start = 0;
+volatile uint64_t Bench::end = 0;
+
+uint64_t Bench::run(void (*worker)(const char*), uint32_t count, uint32_t iterations, const char* arg) {
+    workers = count;
+    loop_count = iterations;
+    ready = 0;
+    running = count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (sys_spawn(worker, arg) < 0) __atomic_sub_fetch(&running, 1, __ATOMIC_ACQ_REL);
+    }
+    while (running) thread_sleep(10);
+
+    return end - start;
+}
+
+void Bench::worker_begin() {
+    if (__atomic_add_fetch(&ready, 1, __ATOMIC_ACQ_REL) == workers) {
+        start = rdtsc();
+    }
+    while (ready < workers) sys_schedule();
+}
+
+void Bench::worker_end() {
+    if (__atomic_sub_fetch(&running, 1, __ATOMIC_ACQ_REL) == 0) {
+        end = rdtsc();
+    }
+}
+
+uint32_t Bench::iterations() {
+    return loop_count;
+}
+
+uint32_t Bench::per_op(uint64_t cycles, uint32_t ops) {
+    return ops ? (uint32_t)div64(cycles, ops) : 0;
+}
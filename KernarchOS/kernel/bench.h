@@ -0,0 +1,29 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "types.h"
+
+// Harness for the shell benchmarks: worker threads are spawned together,
+// timing starts once all of them are running and ends when the last exits
+class Bench {
+public:
+    // Runs from a shell command, blocks the caller until all workers finish
+    static uint64_t run(void (*worker)(const char*), uint32_t workers, uint32_t iterations, const char* arg = nullptr);
+
+    // Called by the workers around their measured loop
+    static void worker_begin();
+    static void worker_end();
+
+    static uint32_t iterations();
+    static uint32_t per_op(uint64_t cycles, uint32_t ops);
+
+private:
+    static volatile uint32_t workers;
+    static volatile uint32_t ready;
+    static volatile uint32_t running;
+    static volatile uint32_t loop_count;
+    static volatile uint64_t start;
+    static volatile uint64_t end;
+};
+
+#endif // BENCH_H
@@ -6,6 +6,26 @@
 #include "interrupts.h"
 #include "stack.h"
 #include "thread.h"
+#include "cpu.h"
+#include "timer.h"
+#include "trace.h"
+#include "math64.h"
+#include "kernel_config.h"
+#include "bench.h"
+#include "fpu.h"
+#include "percpu.h"
+#include "process.h"
+#include "spinlock.h"
+#include "mutex.h"
+#include "semaphore.h"
+#include "condvar.h"
+#include "workqueue.h"
+#include "ringbuffer.h"
+#include "latency.h"
+#include "tasktable.h"
+#include "fiber.h"
+#include "async.h"
+#include "reaper.h"
 
 using namespace std;
 
@@ -22,6 +42,28 @@ void Commands::initialize() {
     add_command("shutdown", "", "Shut down the system", shutdown);
     add_command("test", "", "Starts Threading test", test);
     add_command("about", "", "About the OS", about);
+    add_command("trace", "[clear]", "Dump the binary trace buffer", trace);
+    add_command("ctxbench", "[iterations]", "Measure cycles per context switch between threads", ctxbench);
+    add_command("fpu", "[lazy|eager|reset]", "Show or set the FPU switching mode", fpu);
+    add_command("fpubench", "[rounds]", "Compare lazy and eager FPU switching", fpubench);
+    add_command("cpus", "", "Show per-CPU scheduler state", cpus);
+    add_command("smpbench", "[work]", "Measure compute scaling over the CPUs", smpbench);
+    add_command("lockbench", "[iterations]", "Compare lock acquire cost", lockbench);
+    add_command("fairbench", "[ms]", "Show fair-share CPU split by nice level", fairbench);
+    add_command("edfbench", "[ms]", "Run periodic deadline threads under load", edfbench);
+    add_command("top", "[refreshes]", "Live per-thread CPU usage, any key quits", top);
+    add_command("mutexbench", "[ms]", "Show CPU used by threads blocked on a mutex", mutexbench);
+    add_command("syncbench", "[items]", "Measure semaphore and condition variable handoffs", syncbench);
+    add_command("workbench", "[delay ms]", "Measure workqueue latency and delayed work", workbench);
+    add_command("softirqs", "", "Show per-CPU softirq counters", softirqs);
+    add_command("ringbench", "[items]", "Compare SPSC, MPSC and MPMC ring throughput", ringbench);
+    add_command("tlsbench", "[iterations]", "Measure current thread and ThreadLocal access", tlsbench);
+    add_command("tracer", "[irqsoff|wakeup on|off|reset]", "Interrupts-off and wakeup latency tracers", tracer);
+    add_command("schedbench", "[rounds]", "Measure cold scheduler reads of the task table", schedbench);
+    add_command("spawnbench", "[rounds]", "Measure pooled thread spawn and reuse latency", spawnbench);
+    add_command("fiberbench", "[switches]", "Measure fiber yield, channel and ring switch costs", fiberbench);
+    add_command("asyncbench", "[tasks]", "Measure coroutine memory per pending operation and resume cost", asyncbench);
+    add_command("asyncread", "[keys]", "Echo keys read by a coroutine on the executor", asyncread);
 }
 
 void Commands::add_command(const char* name, const char* args, const char* description, void (*function)(const char*)) {
@@ -60,7 +102,13 @@ void Commands::echo(const char* args) {
 }
 
 void Commands::systeminfo(const char*) {
-    sys_printf("&cUnknown\n");
+    sys_printf("&9CPU: &f%s &7(family %d, model %d)\n", cpu_info.vendor, cpu_info.family, cpu_info.model);
+    sys_printf("&9TSC: &f%d kHz\n", cpu_info.tsc_khz);
+    sys_printf("&9CPUs online: &f%d\n", cpu_count);
+    sys_printf("&9Scheduler clock: &f%s\n", timer_mode_name());
+    sys_printf("&9Tasks: &f%d &9live, &f%d &9PCBs allocated, &f%d &9reaped\n",
+               TaskTable::live(), TaskTable::allocated(), Reaper::reaped());
+    sys_printf("&9Uptime: &f%d ms\n", get_current_time_ms());
 }
 
 void Commands::test(const char*) {
@@ -99,6 +147,1126 @@ void Commands::about(const char* args) {
     sys_printf("&b ===================================================================\n");
 }
 
+void Commands::trace(const char* args) {
+    if (strncmp(args, "clear", 5) == 0) {
+        TraceBuffer::clear();
+        sys_printf("&aTrace buffer cleared\n");
+        return;
+    }
+
+    uint32_t available = TraceBuffer::available();
+    sys_printf("&9Trace level: &f%d&9, records: &f%d &9(total %d)\n", KERNEL_TRACE_LEVEL, available, TraceBuffer::total());
+
+    // Show the newest records, timestamps relative to the first one shown
+    const uint32_t max_shown = 16;
+    uint32_t first = available > max_shown ? available - max_shown : 0;
+    TraceRecord base;
+    if (!TraceBuffer::get(first, &base)) return;
+
+    for (uint32_t i = first; i < available; i++) {
+        TraceRecord record;
+        if (!TraceBuffer::get(i, &record)) break;
+        sys_printf("  &7+%u &b%s &f%u %u 0x%x\n", (uint32_t)(record.tsc - base.tsc),
+                   TraceBuffer::event_name(record.event), record.args[0], record.args[1], record.args[2]);
+    }
+}
+
+// Ping-pong benchmark: on one CPU the two threads yield to each other, so
+// every sys_schedule is one switch between them (with more CPUs they may
+// each get a CPU and the yields become cheaper)
+static void ctx_bench_worker(const char*) {
+    Bench::worker_begin();
+    for (uint32_t i = 0; i < Bench::iterations(); i++) {
+        sys_schedule();
+    }
+    Bench::worker_end();
+}
+
+void Commands::ctxbench(const char* args) {
+    uint32_t iterations = atoi(args);
+    if (iterations == 0) iterations = 10000;
+
+    // Build with FAST_CONTEXT_SWITCH=0 for the frame-copy figure to compare against
+    const char* path = FAST_CONTEXT_SWITCH ? "kernel stack swap" : "frame copy + iretd";
+    uint64_t cycles = Bench::run(ctx_bench_worker, 2, iterations);
+    sys_printf("&9Switches (%s): &f%u&9, cycles/switch: &f%u &7(%d CPUs)\n", path, iterations * 2, Bench::per_op(cycles, iterations * 2), cpu_count);
+}
+
+void Commands::fpu(const char* args) {
+    if (strncmp(args, "lazy", 4) == 0) fpu_set_mode(FPU_LAZY);
+    else if (strncmp(args, "eager", 5) == 0) fpu_set_mode(FPU_EAGER);
+    else if (strncmp(args, "reset", 5) == 0) fpu_reset_stats();
+
+    const FpuStats* stats = fpu_get_stats();
+    sys_printf("&9FPU mode: &f%s&9, save: &f%s&9, state: &f%d bytes\n", fpu_mode_name(), fpu_save_method_name(), fpu_state_size());
+    sys_printf("&9Switches: &f%u &9Traps: &f%u &9Kernel traps: &f%u &9Saves: &f%u &9Restores: &f%u\n",
+               stats->switches, stats->traps, stats->kernel_traps, stats->saves, stats->restores);
+}
+
+// SSE-heavy ping-pong: each round does packed float work, then yields.
+// XMM1 is never written, so a mismatch afterwards means state was lost.
+static volatile uint32_t fpu_bench_corrupted = 0;
+
+static void fpu_bench_worker(const char*) {
+    float seed[4] __attribute__((aligned(16))) = { 1.0001f, 0.9999f, 1.0002f, 0.9998f };
+    float check[4] __attribute__((aligned(16)));
+
+    asm volatile("movaps %0, %%xmm0\n movaps %0, %%xmm1" : : "m"(seed) : "xmm0", "xmm1");
+
+    Bench::worker_begin();
+    for (uint32_t i = 0; i < Bench::iterations(); i++) {
+        for (int k = 0; k < 64; k++) {
+            asm volatile("mulps %%xmm1, %%xmm0\n addps %%xmm1, %%xmm0" : : : "xmm0");
+        }
+        sys_schedule();
+    }
+    Bench::worker_end();
+
+    asm volatile("movaps %%xmm1, %0" : "=m"(check));
+    if (memcmp(check, seed, sizeof(seed)) != 0) fpu_bench_corrupted = 1;
+}
+
+void Commands::fpubench(const char* args) {
+    uint32_t rounds = atoi(args);
+    if (rounds == 0) rounds = 5000;
+
+    FpuMode saved_mode = fpu_get_mode();
+    const FpuMode modes[] = { FPU_LAZY, FPU_EAGER };
+    fpu_bench_corrupted = 0;
+
+    for (FpuMode mode : modes) {
+        fpu_set_mode(mode);
+        fpu_reset_stats();
+        uint64_t cycles = Bench::run(fpu_bench_worker, 2, rounds);
+
+        const FpuStats* stats = fpu_get_stats();
+        sys_printf("&e%s&9: &f%u &9cycles/round, traps &f%u&9, saves &f%u&9, restores &f%u\n",
+                   fpu_mode_name(), Bench::per_op(cycles, rounds * 2), stats->traps, stats->saves, stats->restores);
+    }
+
+    fpu_set_mode(saved_mode);
+    if (fpu_bench_corrupted) sys_printf("&cFPU state was corrupted across a switch!\n");
+}
+
+void Commands::cpus(const char*) {
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        PerCpu* cpu = &::cpus[i];
+        if (!cpu->online) continue;
+
+        PCB* current = cpu->current;
+        sys_printf("&eCPU %u &7(APIC %u)&9: running &f%s %d &7(level %u)&9, queued &f%u&9, switches &f%u&9, steals &f%u&9, IPIs &f%u\n",
+                   cpu->id, cpu->apic_id, current == cpu->idle ? "idle" : "PID", current ? current->pid : 0,
+                   current ? current->mlfq_level : 0, cpu->runqueue.size(), cpu->switches, cpu->steals, cpu->ipis);
+    }
+}
+
+// Raised counts how often top halves asked, runs how many passes it took
+void Commands::softirqs(const char*) {
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        PerCpu* cpu = &::cpus[i];
+        if (!cpu->online) continue;
+
+        sys_printf("&eCPU %u&9:", cpu->id);
+        for (uint32_t type = 0; type < SOFTIRQ_COUNT; type++) {
+            sys_printf(" &f%s &9raised &f%u&9, ran &f%u&9;", Softirq::name((SoftirqType)type),
+                       cpu->softirq_raised[type], cpu->softirq_runs[type]);
+        }
+        sys_printf("\n");
+    }
+}
+
+static uint32_t cycles_to_us(uint64_t cycles) {
+    return cpu_info.tsc_khz ? (uint32_t)div64(cycles * 1000, cpu_info.tsc_khz) : 0;
+}
+
+// Longest interrupts-off section, and the wakeup latency histogram with
+// one row per power of two of TSC cycles
+void Commands::tracer(const char* args) {
+    bool irqsoff = strncmp(args, "irqsoff", 7) == 0;
+    bool wakeup = strncmp(args, "wakeup", 6) == 0;
+    if (irqsoff || wakeup) {
+        const char* action = args + (irqsoff ? 7 : 6);
+        while (*action == ' ') action++;
+
+        if (strncmp(action, "reset", 5) == 0) {
+            if (irqsoff) IrqsoffTracer::reset();
+            else WakeupTracer::reset();
+        } else if (strncmp(action, "on", 2) == 0 || strncmp(action, "off", 3) == 0) {
+            bool on = action[1] == 'n';
+            if (irqsoff) IrqsoffTracer::enable(on);
+            else WakeupTracer::enable(on);
+        }
+    }
+
+    IrqsoffRecord record = IrqsoffTracer::max();
+    sys_printf("&eirqsoff &7(%s)&9: max &f%u us &9on CPU &f%u&9, masked at &f0x%x&9, unmasked at &f0x%x\n",
+               IrqsoffTracer::enabled() ? "on" : "off", cycles_to_us(record.cycles), record.cpu,
+               record.start_site, record.stop_site);
+
+    sys_printf("&ewakeup &7(%s)&9: &f%u &9wakeups, max &f%u us &9(PID &f%u&9)\n",
+               WakeupTracer::enabled() ? "on" : "off", WakeupTracer::count(),
+               cycles_to_us(WakeupTracer::max_cycles()), WakeupTracer::max_pid());
+
+    uint32_t peak = 0;
+    for (uint32_t i = 0; i < WAKEUP_BUCKETS; i++) {
+        if (WakeupTracer::bucket(i) > peak) peak = WakeupTracer::bucket(i);
+    }
+    for (uint32_t i = 0; i < WAKEUP_BUCKETS && peak; i++) {
+        uint32_t count = WakeupTracer::bucket(i);
+        if (!count) continue;
+
+        char bar[33];
+        uint32_t width = count * 32 / peak;
+        if (width == 0) width = 1;
+        for (uint32_t k = 0; k < width; k++) bar[k] = '#';
+        bar[width] = '\0';
+        sys_printf("&7%8u us+ &f%8u &a%s\n", cycles_to_us((uint64_t)1 << i), count, bar);
+    }
+}
+
+// Every worker does the same fixed amount of integer work, so with
+// perfect scaling the elapsed time stays flat as workers are added
+static void smp_bench_worker(const char*) {
+    Bench::worker_begin();
+    uint32_t x = 1;
+    for (uint32_t i = 0; i < Bench::iterations(); i++) {
+        for (int k = 0; k < 1000; k++) {
+            x = x * 1103515245 + 12345;
+        }
+        asm volatile("" : "+r"(x));
+    }
+    Bench::worker_end();
+}
+
+void Commands::smpbench(const char* args) {
+    uint32_t work = atoi(args);
+    if (work == 0) work = 2000;
+
+    uint32_t max_workers = cpu_count < 2 ? 2 : cpu_count;
+    uint64_t base = 0;
+    for (uint32_t workers = 1; workers <= max_workers; workers++) {
+        uint64_t cycles = Bench::run(smp_bench_worker, workers, work);
+        if (workers == 1) base = cycles;
+
+        uint32_t speedup = cycles ? (uint32_t)div64(base * workers * 10, cycles) : 0;
+        sys_printf("&9Workers: &f%u&9, kcycles: &f%u&9, speedup: &f%u.%ux\n",
+                   workers, (uint32_t)div64(cycles, 1000), speedup / 10, speedup % 10);
+    }
+}
+
+// Every lock guards the same one-line critical section, a shared counter
+// increment, so the final count also shows whether exclusion held
+enum LockBenchKind { LOCK_BENCH_SPIN, LOCK_BENCH_TICKET, LOCK_BENCH_MCS, LOCK_BENCH_IRQSAVE, LOCK_BENCH_MUTEX, LOCK_BENCH_KINDS };
+static const char* lock_bench_names[LOCK_BENCH_KINDS] = { "spinlock", "ticket", "mcs", "ticket irqsave", "mutex" };
+
+static Spinlock bench_spinlock;
+static TicketLock bench_ticket;
+static McsLock bench_mcs;
+static Mutex bench_mutex;
+static volatile uint32_t lock_bench_kind = 0;
+static volatile uint32_t lock_bench_counter = 0;
+
+static void lock_bench_loop(uint32_t kind, uint32_t iterations) {
+    McsNode node;
+    for (uint32_t i = 0; i < iterations; i++) {
+        switch (kind) {
+            case LOCK_BENCH_SPIN:
+                bench_spinlock.lock();
+                lock_bench_counter = lock_bench_counter + 1;
+                bench_spinlock.unlock();
+                break;
+            case LOCK_BENCH_TICKET:
+                bench_ticket.lock();
+                lock_bench_counter = lock_bench_counter + 1;
+                bench_ticket.unlock();
+                break;
+            case LOCK_BENCH_MCS:
+                bench_mcs.lock(&node);
+                lock_bench_counter = lock_bench_counter + 1;
+                bench_mcs.unlock(&node);
+                break;
+            case LOCK_BENCH_IRQSAVE: {
+                IrqSaveGuard<TicketLock> guard(bench_ticket);
+                lock_bench_counter = lock_bench_counter + 1;
+                break;
+            }
+            default:
+                bench_mutex.lock();
+                lock_bench_counter = lock_bench_counter + 1;
+                bench_mutex.unlock();
+                break;
+        }
+    }
+}
+
+static void lock_bench_worker(const char*) {
+    Bench::worker_begin();
+    lock_bench_loop(lock_bench_kind, Bench::iterations());
+    Bench::worker_end();
+}
+
+void Commands::lockbench(const char* args) {
+    uint32_t iterations = atoi(args);
+    if (iterations == 0) iterations = 100000;
+
+    uint32_t workers = cpu_count < 2 ? 2 : cpu_count;
+    sys_printf("&9Cycles per acquire, uncontended and with &f%u &9workers:\n", workers);
+
+    for (uint32_t kind = 0; kind < LOCK_BENCH_KINDS; kind++) {
+        // Uncontended: the shell thread alone, the lock line stays in its cache
+        lock_bench_counter = 0;
+        uint64_t begin = rdtsc();
+        lock_bench_loop(kind, iterations);
+        uint32_t single = Bench::per_op(rdtsc() - begin, iterations);
+
+        lock_bench_kind = kind;
+        lock_bench_counter = 0;
+        uint64_t cycles = Bench::run(lock_bench_worker, workers, iterations);
+        bool lost = lock_bench_counter != iterations * workers;
+
+        sys_printf("&e%s&9: &f%u &9alone, &f%u &9contended%s\n", lock_bench_names[kind], single,
+                   Bench::per_op(cycles, iterations * workers), lost ? " &c(lost updates!)" : "");
+    }
+}
+
+// Fair-class threads of different nice levels spin on one CPU; the
+// loops each completes show how the CPU was split between them
+#define FAIR_BENCH_THREADS 3
+static const int32_t fair_bench_nice[FAIR_BENCH_THREADS] = { 0, 5, 10 };
+static const char* fair_bench_ids[FAIR_BENCH_THREADS] = { "0", "1", "2" };
+static volatile uint32_t fair_bench_loops[FAIR_BENCH_THREADS];
+static volatile uint32_t fair_bench_stop = 0;
+
+static void fair_bench_worker(const char* arg) {
+    uint32_t id = atoi(arg);
+    while (!fair_bench_stop) {
+        for (int k = 0; k < 1000; k++) asm volatile("");
+        fair_bench_loops[id] = fair_bench_loops[id] + 1;
+    }
+}
+
+void Commands::fairbench(const char* args) {
+    uint32_t duration = atoi(args);
+    if (duration == 0) duration = 2000;
+
+    uint32_t cpu = cpu_count - 1; // Away from the boot processor when there is a choice
+    uint32_t total_weight = 0;
+    for (int i = 0; i < FAIR_BENCH_THREADS; i++) total_weight += Fair::weight(fair_bench_nice[i]);
+
+    fair_bench_stop = 0;
+    Thread* threads[FAIR_BENCH_THREADS];
+    for (int i = 0; i < FAIR_BENCH_THREADS; i++) {
+        fair_bench_loops[i] = 0;
+        Thread* thread = threads[i] = ThreadManager::create_thread(fair_bench_worker, fair_bench_ids[i], false);
+        if (!thread) continue;
+        ThreadManager::set_joinable(thread);
+        set_process_policy(thread, SCHED_FAIR, fair_bench_nice[i]);
+        set_process_affinity(thread, cpu);
+        wake_process(thread);
+    }
+
+    sys_printf("&9Fair share on CPU &f%u&9, nice", cpu);
+    for (int i = 0; i < FAIR_BENCH_THREADS; i++) {
+        uint32_t expected = Fair::weight(fair_bench_nice[i]) * 1000 / total_weight;
+        sys_printf(" &f%d &7(%u.%u%%)", fair_bench_nice[i], expected / 10, expected % 10);
+    }
+    sys_printf("\n");
+
+    for (int step = 1; step <= 4; step++) {
+        sys_sleep(duration / 4);
+
+        uint32_t loops[FAIR_BENCH_THREADS];
+        uint64_t total = 0;
+        for (int i = 0; i < FAIR_BENCH_THREADS; i++) {
+            loops[i] = fair_bench_loops[i];
+            total += loops[i];
+        }
+
+        sys_printf("&e%u ms&9:", duration * step / 4);
+        for (int i = 0; i < FAIR_BENCH_THREADS; i++) {
+            uint32_t share = total ? (uint32_t)div64((uint64_t)loops[i] * 1000, total) : 0;
+            sys_printf(" &f%u.%u%%", share / 10, share % 10);
+        }
+        sys_printf("\n");
+    }
+
+    fair_bench_stop = 1;
+    for (int i = 0; i < FAIR_BENCH_THREADS; i++) ThreadManager::join(threads[i]);
+}
+
+// Periodic deadline threads spend 3/4 of their runtime per job while a
+// batch hog spins on every CPU; with admission they should not miss
+struct EdfBenchTask {
+    uint32_t runtime_ms;
+    uint32_t deadline_ms;
+    uint32_t period_ms;
+};
+
+#define EDF_BENCH_THREADS 3
+static const EdfBenchTask edf_bench_tasks[EDF_BENCH_THREADS] = { { 2, 10, 10 }, { 3, 15, 20 }, { 5, 50, 50 } };
+static const char* edf_bench_ids[EDF_BENCH_THREADS] = { "0", "1", "2" };
+static volatile uint32_t edf_bench_jobs[EDF_BENCH_THREADS];
+static volatile uint32_t edf_bench_stop = 0;
+static volatile uint32_t edf_bench_done = 0;
+
+static void edf_bench_worker(const char* arg) {
+    uint32_t id = atoi(arg);
+    uint64_t work = (uint64_t)edf_bench_tasks[id].runtime_ms * cpu_info.tsc_khz * 3 / 4;
+
+    // Turned down by admission control, it runs once as a normal thread
+    bool admitted = current_process->policy == SCHED_DEADLINE;
+
+    while (admitted && !edf_bench_stop) {
+        uint64_t start = rdtsc();
+        while (rdtsc() - start < work) asm volatile("pause");
+        edf_bench_jobs[id] = edf_bench_jobs[id] + 1;
+        sys_wait_period();
+    }
+    __atomic_add_fetch(&edf_bench_done, 1, __ATOMIC_RELEASE);
+}
+
+static void edf_bench_hog(const char*) {
+    while (!edf_bench_stop) asm volatile("pause");
+    __atomic_add_fetch(&edf_bench_done, 1, __ATOMIC_RELEASE);
+}
+
+void Commands::edfbench(const char* args) {
+    uint32_t duration = atoi(args);
+    if (duration == 0) duration = 2000;
+
+    edf_bench_stop = 0;
+    edf_bench_done = 0;
+    uint32_t started = 0;
+    PCB* workers[EDF_BENCH_THREADS] = {};
+
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        Thread* hog = ThreadManager::create_thread(edf_bench_hog, nullptr, false);
+        if (!hog) continue;
+        set_process_priority(hog, PRIORITY_BATCH);
+        set_process_affinity(hog, i);
+        wake_process(hog);
+        started++;
+    }
+
+    for (int i = 0; i < EDF_BENCH_THREADS; i++) {
+        const EdfBenchTask* task = &edf_bench_tasks[i];
+        edf_bench_jobs[i] = 0;
+        Thread* thread = ThreadManager::create_thread(edf_bench_worker, edf_bench_ids[i], false);
+        if (!thread) continue;
+
+        if (!set_process_deadline(thread, task->runtime_ms, task->deadline_ms, task->period_ms)) {
+            sys_printf("&c%u/%u/%u ms rejected by admission control\n", task->runtime_ms, task->deadline_ms, task->period_ms);
+        } else {
+            workers[i] = thread;
+        }
+        wake_process(thread);
+        started++;
+    }
+
+    sys_sleep(duration);
+
+    for (int i = 0; i < EDF_BENCH_THREADS; i++) {
+        PCB* pcb = workers[i];
+        if (!pcb) continue;
+        const EdfBenchTask* task = &edf_bench_tasks[i];
+        sys_printf("&e%u/%u/%u ms &9on CPU &f%u&9: jobs &f%u &7(expected %u)&9, misses &f%u\n",
+                   task->runtime_ms, task->deadline_ms, task->period_ms, pcb->affinity,
+                   edf_bench_jobs[i], duration / task->period_ms, pcb->dl_misses);
+    }
+
+    edf_bench_stop = 1;
+    while (edf_bench_done < started) sys_sleep(10);
+}
+
+#define TOP_INTERVAL_MS 1000
+#define TOP_ROWS 16
+
+struct TopRow {
+    PCB* pcb;
+    uint32_t usage;   // Per mille of one CPU over the last interval
+};
+
+static const char* top_state_name(PCB* pcb) {
+    switch (pcb->state) {
+        case RUNNING: return "run";
+        case READY:   return "ready";
+        case BLOCKED: return "block";
+        default:      return "exit";
+    }
+}
+
+static const char* top_class_name(PCB* pcb) {
+    if (pcb->priority == PRIORITY_IDLE) return "idle";
+    if (pcb->policy == SCHED_DEADLINE) return "edf";
+    if (pcb->policy == SCHED_FAIR) return "fair";
+    return "mlfq";
+}
+
+static uint32_t cycles_to_ms(uint64_t cycles) {
+    return cpu_info.tsc_khz ? (uint32_t)div64(cycles, cpu_info.tsc_khz) : 0;
+}
+
+void Commands::top(const char* args) {
+    uint32_t refreshes = atoi(args); // 0 runs until a key is pressed
+    uint64_t last_tsc = rdtsc();
+
+    TaskTable::for_each([](PCB* pcb) { pcb->top_runtime = pcb->stats.runtime; });
+
+    for (uint32_t round = 0; refreshes == 0 || round < refreshes; round++) {
+        for (uint32_t waited = 0; waited < TOP_INTERVAL_MS; waited += 50) {
+            char key;
+            if (sys_read(&key, 1, false)) return;
+            sys_sleep(50);
+        }
+
+        uint64_t now_tsc = rdtsc();
+        uint64_t interval = now_tsc - last_tsc;
+        last_tsc = now_tsc;
+
+        // Usage over the interval, only the busiest rows are kept
+        TopRow rows[TOP_ROWS];
+        uint32_t count = 0;
+        TaskTable::for_each([&](PCB* pcb) {
+            uint64_t runtime = pcb->stats.runtime;
+            uint64_t delta = runtime - pcb->top_runtime;
+            pcb->top_runtime = runtime;
+
+            TopRow row = { pcb, interval ? (uint32_t)div64(delta * 1000, interval) : 0 };
+            uint32_t pos = count < TOP_ROWS ? count : TOP_ROWS;
+            count++;
+            if (pos == TOP_ROWS && rows[TOP_ROWS - 1].usage >= row.usage) return;
+            if (pos == TOP_ROWS) pos--;
+            while (pos > 0 && rows[pos - 1].usage < row.usage) {
+                rows[pos] = rows[pos - 1];
+                pos--;
+            }
+            rows[pos] = row;
+        });
+
+        sys_clear();
+        sys_printf("&eTop &7(%u threads, %u CPUs, any key quits)\n", count, cpu_count);
+        sys_printf("&9  PID CPU STATE CLASS  CPU%%   RUN ms  WAIT ms SLEEP ms    VOL  INVOL\n");
+        for (uint32_t i = 0; i < count && i < TOP_ROWS; i++) {
+            PCB* pcb = rows[i].pcb;
+            const TaskStats* stats = &pcb->stats;
+            sys_printf("&f%5u %3u %5s %5s %3u.%u %8u %8u %8u %6u %6u\n",
+                       pcb->pid, pcb->cpu, top_state_name(pcb), top_class_name(pcb),
+                       rows[i].usage / 10, rows[i].usage % 10,
+                       cycles_to_ms(stats->runtime), cycles_to_ms(stats->wait), cycles_to_ms(stats->sleep),
+                       stats->voluntary, stats->involuntary);
+        }
+    }
+}
+
+// The shell holds a mutex while waiters pile up on it; their runtime
+// while blocked should stay at the short spin before they sleep
+#define MUTEX_BENCH_WAITERS 4
+static Mutex mutex_bench_lock;
+static volatile uint32_t mutex_bench_done = 0;
+
+static void mutex_bench_waiter(const char*) {
+    mutex_bench_lock.lock();
+    mutex_bench_lock.unlock();
+    __atomic_add_fetch(&mutex_bench_done, 1, __ATOMIC_RELEASE);
+}
+
+void Commands::mutexbench(const char* args) {
+    uint32_t hold = atoi(args);
+    if (hold == 0) hold = 500;
+
+    mutex_bench_done = 0;
+    mutex_bench_lock.lock();
+
+    PCB* waiters[MUTEX_BENCH_WAITERS] = {};
+    uint32_t started = 0;
+    for (int i = 0; i < MUTEX_BENCH_WAITERS; i++) {
+        Thread* thread = ThreadManager::create_thread(mutex_bench_waiter, nullptr, false);
+        if (!thread) continue;
+        waiters[i] = thread;
+        wake_process(thread);
+        started++;
+    }
+
+    sys_sleep(hold);
+
+    for (int i = 0; i < MUTEX_BENCH_WAITERS; i++) {
+        PCB* pcb = waiters[i];
+        if (!pcb) continue;
+        uint32_t us = cpu_info.tsc_khz ? (uint32_t)div64(pcb->stats.runtime * 1000, cpu_info.tsc_khz) : 0;
+        sys_printf("&9PID &f%u&9: &f%s&9, ran &f%u us &9of &f%u ms &9waiting\n",
+                   pcb->pid, pcb->state == BLOCKED ? "blocked" : "runnable", us, hold);
+    }
+
+    mutex_bench_lock.unlock();
+    while (mutex_bench_done < started) sys_sleep(10);
+}
+
+// Semaphores as a bounded buffer between a producer and a consumer, then
+// a turn handed around under a condition variable: to the one other
+// thread with signal, and around a ring of threads with broadcast
+#define SYNC_BENCH_SLOTS 8
+#define SYNC_BENCH_RING 4
+static Semaphore sync_bench_free;
+static Semaphore sync_bench_used;
+static uint32_t sync_bench_slots[SYNC_BENCH_SLOTS];
+static Mutex sync_bench_lock;
+static CondVar sync_bench_turn_changed;
+static uint32_t sync_bench_turn;
+static uint32_t sync_bench_threads;
+static volatile uint32_t sync_bench_role = 0;
+static volatile uint32_t sync_bench_errors = 0;
+
+static void sync_bench_semaphore_worker(const char*) {
+    bool producer = __atomic_fetch_add(&sync_bench_role, 1, __ATOMIC_RELAXED) == 0;
+    uint32_t items = Bench::iterations();
+    Bench::worker_begin();
+    for (uint32_t i = 0; i < items; i++) {
+        uint32_t* slot = &sync_bench_slots[i % SYNC_BENCH_SLOTS];
+        if (producer) {
+            sync_bench_free.down();
+            *slot = i;
+            sync_bench_used.up();
+        } else {
+            sync_bench_used.down();
+            if (*slot != i) __atomic_add_fetch(&sync_bench_errors, 1, __ATOMIC_RELAXED);
+            sync_bench_free.up();
+        }
+    }
+    Bench::worker_end();
+}
+
+// arg set: broadcast, the others wake and re-check their predicate
+static void sync_bench_condvar_worker(const char* arg) {
+    uint32_t id = __atomic_fetch_add(&sync_bench_role, 1, __ATOMIC_RELAXED);
+    uint32_t rounds = Bench::iterations();
+    Bench::worker_begin();
+    for (uint32_t i = 0; i < rounds; i++) {
+        sync_bench_lock.lock();
+        while (sync_bench_turn % sync_bench_threads != id) sync_bench_turn_changed.wait(sync_bench_lock);
+        sync_bench_turn++;
+        if (arg) sync_bench_turn_changed.broadcast();
+        else sync_bench_turn_changed.signal();
+        sync_bench_lock.unlock();
+    }
+    Bench::worker_end();
+}
+
+static uint32_t sync_bench_condvar(uint32_t threads, uint32_t rounds, bool broadcast) {
+    sync_bench_role = 0;
+    sync_bench_turn = 0;
+    sync_bench_threads = threads;
+    uint64_t cycles = Bench::run(sync_bench_condvar_worker, threads, rounds, broadcast ? "broadcast" : nullptr);
+    if (sync_bench_turn != threads * rounds) __atomic_add_fetch(&sync_bench_errors, 1, __ATOMIC_RELAXED);
+    return Bench::per_op(cycles, threads * rounds);
+}
+
+void Commands::syncbench(const char* args) {
+    uint32_t items = atoi(args);
+    if (items == 0) items = 10000;
+
+    sync_bench_free.init(SYNC_BENCH_SLOTS);
+    sync_bench_used.init(0);
+    sync_bench_role = 0;
+    sync_bench_errors = 0;
+    uint64_t cycles = Bench::run(sync_bench_semaphore_worker, 2, items);
+    sys_printf("&9Semaphore producer/consumer, &f%u &9slots: &f%u &9cycles per item%s\n",
+               SYNC_BENCH_SLOTS, Bench::per_op(cycles, items), sync_bench_errors ? " &c(out of order!)" : "");
+
+    sync_bench_errors = 0;
+    uint32_t signal = sync_bench_condvar(2, items, false);
+    uint32_t laps = items / SYNC_BENCH_RING ? items / SYNC_BENCH_RING : 1;
+    uint32_t broadcast = sync_bench_condvar(SYNC_BENCH_RING, laps, true);
+    sys_printf("&9CondVar cycles per turn: &fsignal %u &9(2 threads), &fbroadcast %u &9(%u threads)%s\n",
+               signal, broadcast, SYNC_BENCH_RING, sync_bench_errors ? " &c(turns lost!)" : "");
+}
+
+// A burst of work items measures queue to run latency of the worker
+// pool, one delayed item shows how close to its delay it fires
+#define WORK_BENCH_ITEMS 32
+struct WorkBenchItem {
+    Work work;
+    uint64_t queued;
+    uint64_t latency;
+};
+static WorkBenchItem work_bench_items[WORK_BENCH_ITEMS];
+static Work work_bench_timer;
+static volatile uint32_t work_bench_done = 0;
+static volatile uint32_t work_bench_fired = 0;
+
+static void work_bench_run(Work* work) {
+    WorkBenchItem* item = (WorkBenchItem*)work->context;
+    item->latency = rdtsc() - item->queued;
+    __atomic_add_fetch(&work_bench_done, 1, __ATOMIC_RELEASE);
+}
+
+static void work_bench_expired(Work*) {
+    work_bench_fired = get_current_time_ms();
+}
+
+void Commands::workbench(const char* args) {
+    uint32_t delay = atoi(args);
+    if (delay == 0) delay = 50;
+
+    if (WorkQueue::workers() == 0) {
+        sys_printf("&cNo workqueue workers running\n");
+        return;
+    }
+
+    work_bench_done = 0;
+    work_bench_fired = 0;
+    WorkQueue::init(&work_bench_timer, work_bench_expired);
+    uint32_t start = get_current_time_ms();
+    WorkQueue::queue_delayed(&work_bench_timer, delay);
+
+    for (int i = 0; i < WORK_BENCH_ITEMS; i++) {
+        WorkBenchItem* item = &work_bench_items[i];
+        WorkQueue::init(&item->work, work_bench_run, item);
+        item->queued = rdtsc();
+        WorkQueue::queue(&item->work);
+    }
+    while (work_bench_done < WORK_BENCH_ITEMS || !work_bench_fired) sys_sleep(1);
+
+    uint64_t total = 0;
+    uint64_t worst = 0;
+    for (int i = 0; i < WORK_BENCH_ITEMS; i++) {
+        total += work_bench_items[i].latency;
+        if (work_bench_items[i].latency > worst) worst = work_bench_items[i].latency;
+    }
+    sys_printf("&9%u items on &f%u &9workers, queue to run: &f%u &9cycles avg, &f%u &9worst\n",
+               WORK_BENCH_ITEMS, WorkQueue::workers(), Bench::per_op(total, WORK_BENCH_ITEMS), (uint32_t)worst);
+    sys_printf("&9Delayed by &f%u ms&9, ran after &f%u ms\n", delay, work_bench_fired - start);
+}
+
+// One producer and one consumer thread move items through each kind of
+// ring, SPSC in batches; a full or empty ring yields the CPU
+#define RING_BENCH_KINDS 3
+#define RING_BENCH_BATCH 16
+static const char* ring_bench_names[RING_BENCH_KINDS] = { "spsc", "mpsc", "mpmc" };
+static SpscRing<uint32_t, 256> ring_bench_spsc;
+static MpscRing<uint32_t, 256> ring_bench_mpsc;
+static MpmcRing<uint32_t, 256> ring_bench_mpmc;
+static volatile uint32_t ring_bench_kind = 0;
+static volatile uint32_t ring_bench_role = 0;
+static volatile uint32_t ring_bench_errors = 0;
+
+static uint32_t ring_bench_push(const uint32_t* items, uint32_t count) {
+    if (ring_bench_kind == 0) return ring_bench_spsc.push_batch(items, count);
+    if (ring_bench_kind == 1) return ring_bench_mpsc.push_batch(items, count);
+    return ring_bench_mpmc.push_batch(items, count);
+}
+
+static uint32_t ring_bench_pop(uint32_t* items, uint32_t count) {
+    if (ring_bench_kind == 0) return ring_bench_spsc.pop_batch(items, count);
+    if (ring_bench_kind == 1) return ring_bench_mpsc.pop_batch(items, count);
+    return ring_bench_mpmc.pop_batch(items, count);
+}
+
+static void ring_bench_worker(const char*) {
+    bool producer = __atomic_fetch_add(&ring_bench_role, 1, __ATOMIC_RELAXED) == 0;
+    uint32_t total = Bench::iterations();
+    uint32_t batch = ring_bench_kind == 0 ? RING_BENCH_BATCH : 1;
+    uint32_t items[RING_BENCH_BATCH];
+
+    Bench::worker_begin();
+    for (uint32_t done = 0; done < total;) {
+        uint32_t count = total - done < batch ? total - done : batch;
+        uint32_t moved;
+        if (producer) {
+            for (uint32_t i = 0; i < count; i++) items[i] = done + i;
+            moved = ring_bench_push(items, count);
+        } else {
+            moved = ring_bench_pop(items, count);
+            for (uint32_t i = 0; i < moved; i++) {
+                if (items[i] != done + i) __atomic_add_fetch(&ring_bench_errors, 1, __ATOMIC_RELAXED);
+            }
+        }
+        if (!moved) sys_schedule();
+        done += moved;
+    }
+    Bench::worker_end();
+}
+
+void Commands::ringbench(const char* args) {
+    uint32_t items = atoi(args);
+    if (items == 0) items = 100000;
+
+    sys_printf("&9Cycles per item, one producer and one consumer:\n");
+    for (uint32_t kind = 0; kind < RING_BENCH_KINDS; kind++) {
+        ring_bench_kind = kind;
+        ring_bench_role = 0;
+        ring_bench_errors = 0;
+        uint64_t cycles = Bench::run(ring_bench_worker, 2, items);
+        sys_printf("&e%s&9: &f%u%s\n", ring_bench_names[kind], Bench::per_op(cycles, items),
+                   ring_bench_errors ? " &c(out of order!)" : "");
+    }
+}
+
+// Current thread lookups, and a ThreadLocal counter that every worker
+// bumps on its own; a shared slot would show up as a wrong count
+#define TLS_BENCH_WORKERS 4
+static ThreadLocal<uint32_t> tls_bench_counter;
+static volatile uint32_t tls_bench_errors = 0;
+
+static void tls_bench_worker(const char*) {
+    uint32_t iterations = Bench::iterations();
+    Bench::worker_begin();
+    for (uint32_t i = 0; i < iterations; i++) {
+        (*tls_bench_counter)++;
+        if (i % 64 == 0) sys_schedule(); // Switch often so other threads touch their copies
+    }
+    if (*tls_bench_counter != iterations) __atomic_add_fetch(&tls_bench_errors, 1, __ATOMIC_RELAXED);
+    Bench::worker_end();
+}
+
+void Commands::tlsbench(const char* args) {
+    uint32_t iterations = atoi(args);
+    if (iterations == 0) iterations = 100000;
+
+    Thread* volatile sink;
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < iterations; i++) sink = current_process;
+    uint64_t pcb_cycles = rdtsc() - start;
+
+    start = rdtsc();
+    for (uint32_t i = 0; i < iterations; i++) sink = ThreadManager::get_current_thread();
+    uint64_t tls_cycles = rdtsc() - start;
+    (void)sink;
+
+    sys_printf("&9Current thread, cycles: &fvia GS %u&9, &fvia FS %u\n",
+               Bench::per_op(pcb_cycles, iterations), Bench::per_op(tls_cycles, iterations));
+
+    tls_bench_errors = 0;
+    uint64_t cycles = Bench::run(tls_bench_worker, TLS_BENCH_WORKERS, iterations);
+    sys_printf("&9ThreadLocal increment: &f%u &9cycles with &f%u &9threads%s, &f%u &9of &f%u &9TLS bytes used\n",
+               Bench::per_op(cycles, iterations * TLS_BENCH_WORKERS), TLS_BENCH_WORKERS,
+               tls_bench_errors ? " &c(shared copies!)" : "", Tls::used(), TLS_SIZE);
+}
+
+// Cache lines from the start of the task to the end of a field
+#define TASK_LINES(field) ((__builtin_offsetof(PCB, field) + sizeof(((PCB*)0)->field) + TASK_CACHE_LINE - 1) / TASK_CACHE_LINE)
+
+static PCB* sched_bench_tasks[MAX_TASKS];
+
+static void flush_tasks(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t offset = 0; offset < sizeof(PCB); offset += TASK_CACHE_LINE) {
+            clflush((uint8_t*)sched_bench_tasks[i] + offset);
+        }
+    }
+    mfence();
+}
+
+// Walks the live tasks with their lines evicted first, the way a pick
+// or a wakeup finds a task that has not run for a while. The pointers
+// are copied out first so the walk touches nothing but the tasks.
+void Commands::schedbench(const char* args) {
+    uint32_t rounds = atoi(args);
+    if (rounds == 0) rounds = 100;
+    if (!cpu_has(CPUID_EDX_CLFSH)) {
+        sys_printf("&cCLFLUSH is not supported\n");
+        return;
+    }
+
+    // Released PCBs stay PCBs, so the copies stay safe to read
+    uint32_t count = 0;
+    TaskTable::for_each([&](PCB* pcb) {
+        if (count < MAX_TASKS) sched_bench_tasks[count++] = pcb;
+    });
+
+    uint64_t pick_cycles = 0;
+    uint64_t class_cycles = 0;
+    uint32_t sink = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        flush_tasks(count);
+        uint64_t start = rdtsc();
+        for (uint32_t i = 0; i < count; i++) {
+            volatile PCB* pcb = sched_bench_tasks[i];
+            sink += (uint32_t)pcb->state + (uint32_t)pcb->policy + pcb->mlfq_level + pcb->cpu + pcb->affinity + pcb->wake_time + pcb->sleep_index;
+        }
+        pick_cycles += rdtsc() - start;
+
+        // The fair and deadline class keys as well
+        flush_tasks(count);
+        start = rdtsc();
+        for (uint32_t i = 0; i < count; i++) {
+            volatile PCB* pcb = sched_bench_tasks[i];
+            sink += (uint32_t)pcb->state + (uint32_t)pcb->policy + pcb->mlfq_level + pcb->wake_time + (uint32_t)pcb->vruntime + pcb->dl_abs_deadline;
+        }
+        class_cycles += rdtsc() - start;
+    }
+    (void)sink;
+
+    sys_printf("&9Task: &f%u &9bytes, pick fields in &f%u &9line(s), class keys in &f%u\n",
+               (uint32_t)sizeof(PCB), (uint32_t)TASK_LINES(run_start), (uint32_t)TASK_LINES(tls));
+    sys_printf("&9Cold scan, cycles per task: &fpick %u&9, &fpick + class keys %u\n",
+               Bench::per_op(pick_cycles, rounds * count), Bench::per_op(class_cycles, rounds * count));
+}
+
+// Fans out a batch of one-job threads, joins them and spawns the next
+// batch. Each job records when it first ran; a spawn that gets back the
+// shell of a job from the previous batch also gives the exit-to-reuse
+// time, which covers the reaper and the join.
+#define SPAWN_BENCH_BATCH 8
+
+struct SpawnBenchJob {
+    uint64_t created;   // Before create_thread
+    uint64_t started;   // First thing the job does
+    uint64_t exited;    // Last thing the job does
+};
+
+static SpawnBenchJob spawn_bench_jobs[SPAWN_BENCH_BATCH];
+
+static void spawn_bench_worker(const char* arg) {
+    SpawnBenchJob* job = (SpawnBenchJob*)arg;
+    job->started = rdtsc();
+    job->exited = rdtsc();
+}
+
+void Commands::spawnbench(const char* args) {
+    uint32_t rounds = atoi(args);
+    if (rounds == 0) rounds = 50;
+
+    Thread* threads[SPAWN_BENCH_BATCH] = {};
+    uint64_t exited[SPAWN_BENCH_BATCH] = {};
+    uint64_t first_run = 0, reuse = 0;
+    uint32_t spawned = 0, reused = 0;
+    uint32_t allocated = TaskTable::allocated();
+    uint64_t begin = rdtsc();
+
+    for (uint32_t r = 0; r < rounds; r++) {
+        Thread* previous[SPAWN_BENCH_BATCH];
+        memcpy(previous, threads, sizeof(threads));
+
+        for (uint32_t i = 0; i < SPAWN_BENCH_BATCH; i++) {
+            SpawnBenchJob* job = &spawn_bench_jobs[i];
+            job->created = rdtsc();
+            Thread* thread = ThreadManager::create_thread(spawn_bench_worker, (const char*)job, false);
+            uint64_t now = rdtsc();
+            threads[i] = thread;
+            if (!thread) continue;
+
+            for (uint32_t j = 0; j < SPAWN_BENCH_BATCH; j++) {
+                if (previous[j] != thread) continue;
+                reuse += now - exited[j];
+                reused++;
+            }
+            ThreadManager::set_joinable(thread);
+            wake_process(thread);
+        }
+
+        for (uint32_t i = 0; i < SPAWN_BENCH_BATCH; i++) {
+            if (!threads[i]) continue;
+            ThreadManager::join(threads[i]);
+            SpawnBenchJob* job = &spawn_bench_jobs[i];
+            first_run += job->started - job->created;
+            exited[i] = job->exited;
+            spawned++;
+        }
+    }
+    uint64_t total = rdtsc() - begin;
+
+    sys_printf("&9Spawned &f%u &9threads in batches of &f%u&9, &f%u &9new PCBs, &f%u &9shells pooled\n",
+               spawned, SPAWN_BENCH_BATCH, TaskTable::allocated() - allocated, TaskTable::pooled());
+    sys_printf("&9Cycles: &fcreate to first run %u&9, &fexit to reuse %u &9(%u reuses), &fspawn + join %u\n",
+               Bench::per_op(first_run, spawned), Bench::per_op(reuse, reused), reused, Bench::per_op(total, spawned));
+}
+
+// Fiber switches: two fibers yielding to each other, a ping-pong over
+// two channels on one carrier, then a token passed around a ring of
+// fibers spread over one carrier per CPU
+#define FIBER_BENCH_RING 64
+
+static Channel<uint32_t, 1> fiber_bench_ping;
+static Channel<uint32_t, 1> fiber_bench_pong;
+static Channel<uint32_t, 1> fiber_bench_ring[FIBER_BENCH_RING];
+static uint32_t fiber_bench_count;
+static volatile uint32_t fiber_bench_gate;   // 0 wait, 1 run, 2 called off
+static volatile uint64_t fiber_bench_start;
+static volatile uint64_t fiber_bench_end;
+
+// Fibers hold here until all of them are spawned, so one that failed to
+// spawn cannot leave its peers blocked on a channel forever
+static bool fiber_bench_released() {
+    while (__atomic_load_n(&fiber_bench_gate, __ATOMIC_ACQUIRE) == 0) Fibers::yield();
+    return fiber_bench_gate == 1;
+}
+
+// Fiber 0 times the run
+static void fiber_bench_yielder(void* arg) {
+    if (!fiber_bench_released()) return;
+    bool first = arg == nullptr;
+    if (first) fiber_bench_start = rdtsc();
+    for (uint32_t i = 0; i < fiber_bench_count; i++) Fibers::yield();
+    if (first) fiber_bench_end = rdtsc();
+}
+
+// Fiber 0 pings and times the run, fiber 1 pongs
+static void fiber_bench_ping_pong(void* arg) {
+    if (!fiber_bench_released()) return;
+    if (arg) {
+        for (uint32_t i = 0; i < fiber_bench_count; i++) fiber_bench_pong.send(fiber_bench_ping.recv());
+        return;
+    }
+
+    fiber_bench_start = rdtsc();
+    for (uint32_t i = 0; i < fiber_bench_count; i++) {
+        fiber_bench_ping.send(i);
+        fiber_bench_pong.recv();
+    }
+    fiber_bench_end = rdtsc();
+}
+
+// Fiber i passes the token from its channel to the next one, fiber 0
+// starts and ends every lap
+static void fiber_bench_ring_member(void* arg) {
+    if (!fiber_bench_released()) return;
+    uint32_t id = (uint32_t)arg;
+    Channel<uint32_t, 1>* in = &fiber_bench_ring[id];
+    Channel<uint32_t, 1>* out = &fiber_bench_ring[(id + 1) % FIBER_BENCH_RING];
+
+    if (id == 0) fiber_bench_start = rdtsc();
+    for (uint32_t lap = 0; lap < fiber_bench_count; lap++) {
+        if (id == 0) out->send(lap);
+        uint32_t token = in->recv();
+        if (id != 0) out->send(token);
+    }
+    if (id == 0) fiber_bench_end = rdtsc();
+}
+
+// Runs fibers entry(0) .. entry(fibers - 1) on carriers until they all
+// finish; false, with the run called off, if any of it failed to start
+static bool fiber_bench_run(void (*entry)(void*), uint32_t fibers, uint32_t carriers) {
+    if (!Fibers::start(carriers)) {
+        sys_printf("&cFiber carriers already running\n");
+        return false;
+    }
+
+    fiber_bench_gate = 0;
+    uint32_t spawned = 0;
+    while (spawned < fibers && Fibers::spawn(entry, (void*)spawned)) spawned++;
+    __atomic_store_n(&fiber_bench_gate, spawned == fibers ? 1 : 2, __ATOMIC_RELEASE);
+    Fibers::stop();
+
+    if (spawned < fibers) sys_printf("&cOnly %u of %u fibers could be spawned\n", spawned, fibers);
+    return spawned == fibers;
+}
+
+static uint32_t cycles_to_ns(uint32_t cycles) {
+    return cpu_info.tsc_khz ? (uint32_t)div64((uint64_t)cycles * 1000000, cpu_info.tsc_khz) : 0;
+}
+
+void Commands::fiberbench(const char* args) {
+    uint32_t count = atoi(args);
+    if (count == 0) count = 10000;
+    fiber_bench_count = count;
+
+    if (!fiber_bench_run(fiber_bench_yielder, 2, 1)) return;
+    uint32_t yield = Bench::per_op(fiber_bench_end - fiber_bench_start, count * 2);
+
+    if (!fiber_bench_run(fiber_bench_ping_pong, 2, 1)) return;
+    uint32_t channel = Bench::per_op(fiber_bench_end - fiber_bench_start, count * 2);
+
+    sys_printf("&9Fiber switch, cycles: &fyield %u &9(%u ns)&9, &fchannel %u &9(%u ns)\n",
+               yield, cycles_to_ns(yield), channel, cycles_to_ns(channel));
+
+    uint32_t carriers = cpu_count < FIBER_CARRIERS_MAX ? cpu_count : FIBER_CARRIERS_MAX;
+    uint32_t laps = count / FIBER_BENCH_RING ? count / FIBER_BENCH_RING : 1;
+    fiber_bench_count = laps;
+    if (!fiber_bench_run(fiber_bench_ring_member, FIBER_BENCH_RING, carriers)) return;
+    uint32_t hop = Bench::per_op(fiber_bench_end - fiber_bench_start, laps * FIBER_BENCH_RING);
+
+    sys_printf("&9Ring of &f%u &9fibers on &f%u &9carriers: &f%u &9cycles (%u ns) per hop\n",
+               FIBER_BENCH_RING, carriers, hop, cycles_to_ns(hop));
+}
+
+// Coroutines: many activities pending on timers at once, each awaiting
+// a child task when it wakes, then one coroutine yielding in a loop
+static WaitQueue async_bench_queue;
+static uint32_t async_bench_done;
+static uint32_t async_bench_errors;
+
+static void async_bench_finish() {
+    uint32_t flags = async_bench_queue.lock_irqsave();
+    async_bench_done++;
+    async_bench_queue.unlock_irqrestore(flags);
+    async_bench_queue.wake_all();
+}
+
+static Task<uint32_t> async_bench_child(uint32_t id) {
+    co_await Executor::yield();
+    co_return id * 2;
+}
+
+static Task<> async_bench_activity(uint32_t id) {
+    co_await Executor::sleep(50 + id % 16);
+    uint32_t doubled = co_await async_bench_child(id);
+    if (doubled != id * 2) async_bench_errors++;
+    async_bench_finish();
+}
+
+static Task<> async_bench_yielder(uint32_t count, uint64_t* cycles) {
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < count; i++) co_await Executor::yield();
+    *cycles = rdtsc() - start;
+    async_bench_finish();
+}
+
+void Commands::asyncbench(const char* args) {
+    uint32_t count = atoi(args);
+    if (count == 0) count = 1000;
+
+    async_bench_done = 0;
+    async_bench_errors = 0;
+    uint32_t peak = Executor::frame_bytes();
+    uint32_t spawned = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!Executor::spawn(async_bench_activity(i))) break;
+        spawned++;
+        uint32_t bytes = Executor::frame_bytes();
+        if (bytes > peak) peak = bytes;
+    }
+    async_bench_queue.wait_until([&] { return async_bench_done == spawned; });
+    if (spawned == 0) return;
+
+    uint32_t per_task = (peak - Executor::frame_bytes()) / spawned;
+    uint32_t per_thread = THREAD_STACK_SIZE + THREAD_KERNEL_STACK_SIZE + sizeof(PCB);
+    sys_printf("&9Finished &f%u &9sleeping tasks, &f%u &9errors: &f%u &9bytes each pending, a thread takes &f%u\n",
+               spawned, async_bench_errors, per_task, per_thread);
+
+    uint64_t cycles = 0;
+    uint32_t resumes = Executor::resumes();
+    async_bench_done = 0;
+    if (!Executor::spawn(async_bench_yielder(count * 10, &cycles))) return;
+    async_bench_queue.wait_until([] { return async_bench_done == 1; });
+    uint32_t yield = Bench::per_op(cycles, count * 10);
+
+    sys_printf("&9Coroutine yield: &f%u &9cycles (%u ns), &f%u &9resumes\n",
+               yield, cycles_to_ns(yield), Executor::resumes() - resumes);
+}
+
+// The keyboard awaitable: a coroutine waits on the keyboard's reader
+// queue through AsyncWait while the shell thread sleeps
+static Task<> async_read_keys(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        char key = co_await async_getchar();
+        sys_printf("%c", key);
+    }
+    async_bench_finish();
+}
+
+void Commands::asyncread(const char* args) {
+    uint32_t count = atoi(args);
+    if (count == 0) count = 8;
+
+    sys_printf("&9Type &f%u &9keys:\n", count);
+    uint32_t resumes = Executor::resumes();
+    async_bench_done = 0;
+    if (!Executor::spawn(async_read_keys(count))) return;
+    async_bench_queue.wait_until([] { return async_bench_done == 1; });
+
+    sys_printf("\n&9Read &f%u &9keys in &f%u &9resumes\n", count, Executor::resumes() - resumes);
+}
+
 void Commands::shutdown(const char* args) {
     (void)args;
     sys_printf("&4Shutting down...\n");
@@ -33,6 +33,28 @@ private:
     static void shutdown(const char* args);
     static void test(const char* args);
     static void about(const char* args);
+    static void trace(const char* args);
+    static void ctxbench(const char* args);
+    static void fpu(const char* args);
+    static void fpubench(const char* args);
+    static void cpus(const char* args);
+    static void smpbench(const char* args);
+    static void lockbench(const char* args);
+    static void fairbench(const char* args);
+    static void edfbench(const char* args);
+    static void top(const char* args);
+    static void mutexbench(const char* args);
+    static void syncbench(const char* args);
+    static void workbench(const char* args);
+    static void softirqs(const char* args);
+    static void ringbench(const char* args);
+    static void tlsbench(const char* args);
+    static void tracer(const char* args);
+    static void schedbench(const char* args);
+    static void spawnbench(const char* args);
+    static void fiberbench(const char* args);
+    static void asyncbench(const char* args);
+    static void asyncread(const char* args);
 
 };
 
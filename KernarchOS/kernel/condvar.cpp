@@ -0,0 +1,17 @@
+#include "condvar.h"
+
+void CondVar::wait(Mutex& mutex) {
+    // Queued before the mutex is released, so a signal after the unlock finds us
+    uint32_t flags = waiters.lock_irqsave();
+    mutex.unlock();
+    waiters.sleep_locked(flags);
+    mutex.lock();
+}
+
+void CondVar::signal() {
+    waiters.wake_one();
+}
+
+void CondVar::broadcast() {
+    waiters.wake_all();
+}
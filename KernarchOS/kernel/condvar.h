@@ -0,0 +1,22 @@
+#ifndef CONDVAR_H
+#define CONDVAR_H
+
+#include "types.h"
+#include "mutex.h"
+#include "waitqueue.h"
+
+// Condition variable for use with Mutex. As usual the waiter re-checks
+// its predicate in a loop, wait() may return without a signal.
+class CondVar {
+public:
+    // Atomically releases the mutex and sleeps, holds it again on return
+    void wait(Mutex& mutex);
+
+    void signal();
+    void broadcast();
+
+private:
+    WaitQueue waiters;
+};
+
+#endif // CONDVAR_H
@@ -1,44 +1,74 @@
 section .text
-global load_context
+global switch_stacks
 
-; load_context(interrupt_frame* context)
-; Does not return - switches directly to new context
-load_context:
-    cli                           ; Ensure interrupts are disabled
+; switch_stacks(uint32_t* prev_esp, uint32_t next_esp)
+; Kernel-to-kernel switch: only callee-saved registers are kept, the rest of
+; the interrupted state stays on each thread's own kernel stack
+switch_stacks:
+    mov eax, [esp + 4]           ; Where to save the old stack pointer
+    mov edx, [esp + 8]           ; Stack pointer to resume
 
-    mov eax, cr0          ; Load current CR0 value into EAX
-    or eax, 0x8           ; Set the TS flag (bit 3)
-    mov cr0, eax          ; Store the updated value back into CR0
+    push ebp
+    push ebx
+    push esi
+    push edi
 
-    mov eax, [esp + 4]           ; Get context pointer parameter
-    
-    ; Load all segment registers first
+    mov [eax], esp
+    mov esp, edx
+
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret                          ; Into the next thread's schedule() or thread_first_run
+
+global save_and_load_context
+extern frame_switch_tail
+
+; save_and_load_context(uint32_t* prev_esp, interrupt_frame* next)
+; FAST_CONTEXT_SWITCH=0 only: saves the old thread like switch_stacks, then
+; irets into a ring 3 frame copied into the next thread's PCB
+save_and_load_context:
+    mov eax, [esp + 4]
+    mov edx, [esp + 8]
+
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp               ; switch_stacks to it returns to our caller
+
+    push edx
+    call frame_switch_tail       ; Finishes the switch, the frame stays our argument
+    mov eax, [esp]
+
+    ; Segment and general registers, GS and FS stay this CPU's as in interrupt_return
     mov dx, [eax + 16]           ; DS offset 16
     mov ds, dx
     mov dx, [eax + 12]           ; ES offset 12
     mov es, dx
-    mov dx, [eax + 8]            ; FS offset 8
-    mov fs, dx
-    mov dx, [eax + 4]            ; GS offset 4
-    mov gs, dx
-    
-    ; Load general registers
     mov edi, [eax + 20]          ; EDI offset 20
     mov esi, [eax + 24]          ; ESI offset 24
     mov ebx, [eax + 36]          ; EBX offset 36
     mov edx, [eax + 40]          ; EDX offset 40
     mov ecx, [eax + 44]          ; ECX offset 44
-    
-    ; Set up stack for iretd
+
+    ; Ring 3 frame for iretd
     push dword [eax + 72]        ; SS offset 72
     push dword [eax + 68]        ; ESP offset 68
     push dword [eax + 64]        ; EFLAGS offset 64
     push dword [eax + 60]        ; CS offset 60
     push dword [eax + 56]        ; EIP offset 56
-    
-    ; Load EBP and EAX last
+
     mov ebp, [eax + 28]          ; EBP offset 28
     mov eax, [eax + 48]          ; EAX offset 48
-    
-    ; Switch context
-    iretd
\ No newline at end of file
+    iretd
+
+global thread_first_run
+extern schedule_tail
+extern interrupt_return
+
+; A new thread's first switch_stacks returns here instead of into schedule()
+thread_first_run:
+    call schedule_tail
+    jmp interrupt_return         ; Interrupts stay off until its iretd
@@ -0,0 +1,92 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include "types.h"
+
+// The part of <coroutine> the compiler relies on, built on the GCC
+// builtins, as the hosted header does not come with a freestanding
+// toolchain. The compiler looks these names up in namespace std.
+namespace std {
+
+template<typename Ret, typename... Args>
+struct coroutine_traits {
+    using promise_type = typename Ret::promise_type;
+};
+
+template<typename Promise = void>
+struct coroutine_handle;
+
+template<>
+struct coroutine_handle<void> {
+    constexpr coroutine_handle() noexcept : frame(nullptr) {}
+    constexpr coroutine_handle(decltype(nullptr)) noexcept : frame(nullptr) {}
+
+    static coroutine_handle from_address(void* address) noexcept {
+        coroutine_handle handle;
+        handle.frame = address;
+        return handle;
+    }
+
+    void* address() const noexcept { return frame; }
+    explicit operator bool() const noexcept { return frame != nullptr; }
+
+    bool done() const noexcept { return __builtin_coro_done(frame); }
+    void operator()() const { resume(); }
+    void resume() const { __builtin_coro_resume(frame); }
+    void destroy() const { __builtin_coro_destroy(frame); }
+
+protected:
+    void* frame;
+};
+
+template<typename Promise>
+struct coroutine_handle : coroutine_handle<> {
+    using coroutine_handle<>::coroutine_handle;
+
+    static coroutine_handle from_address(void* address) noexcept {
+        coroutine_handle handle;
+        handle.frame = address;
+        return handle;
+    }
+
+    static coroutine_handle from_promise(Promise& promise) noexcept {
+        coroutine_handle handle;
+        handle.frame = __builtin_coro_promise((char*)&promise, __alignof(Promise), true);
+        return handle;
+    }
+
+    Promise& promise() const {
+        return *(Promise*)__builtin_coro_promise(frame, __alignof(Promise), false);
+    }
+};
+
+// A frame whose resume and destroy do nothing. GCC frames start with
+// those two function pointers, which is all a handle ever calls.
+struct noop_coroutine_frame {
+    void (*resume)(noop_coroutine_frame*);
+    void (*destroy)(noop_coroutine_frame*);
+};
+
+inline void noop_coroutine_function(noop_coroutine_frame*) {}
+inline noop_coroutine_frame noop_coroutine_instance = { noop_coroutine_function, noop_coroutine_function };
+
+// Resuming it does nothing, for symmetric transfer with nowhere to go
+inline coroutine_handle<> noop_coroutine() noexcept {
+    return coroutine_handle<>::from_address(&noop_coroutine_instance);
+}
+
+struct suspend_always {
+    constexpr bool await_ready() const noexcept { return false; }
+    constexpr void await_suspend(coroutine_handle<>) const noexcept {}
+    constexpr void await_resume() const noexcept {}
+};
+
+struct suspend_never {
+    constexpr bool await_ready() const noexcept { return true; }
+    constexpr void await_suspend(coroutine_handle<>) const noexcept {}
+    constexpr void await_resume() const noexcept {}
+};
+
+} // namespace std
+
+#endif // COROUTINE_H
@@ -0,0 +1,28 @@
+#include "cpu.h"
+#include "cstring.h"
+#include "logger.h"
+
+CpuInfo cpu_info;
+
+void cpu_detect() {
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    cpu_info.max_leaf = eax;
+    memcpy(cpu_info.vendor, &ebx, 4);
+    memcpy(cpu_info.vendor + 4, &edx, 4);
+    memcpy(cpu_info.vendor + 8, &ecx, 4);
+    cpu_info.vendor[12] = '\0';
+
+    if (cpu_info.max_leaf >= 1) {
+        cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+        cpu_info.family = (eax >> 8) & 0xF;
+        cpu_info.model = (eax >> 4) & 0xF;
+        if (cpu_info.family == 0xF) cpu_info.family += (eax >> 20) & 0xFF;
+        if (cpu_info.family >= 6) cpu_info.model |= ((eax >> 16) & 0xF) << 4;
+        cpu_info.features_ecx = ecx;
+        cpu_info.features_edx = edx;
+    }
+
+    Logger::log(LogLevel::DEBUG, "CPU: %s family %d model %d", cpu_info.vendor, cpu_info.family, cpu_info.model);
+}
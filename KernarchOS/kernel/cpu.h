@@ -0,0 +1,131 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include "types.h"
+#include "kernel_config.h"
+
+// CPUID.01H feature bits
+#define CPUID_EDX_TSC   (1 << 4)
+#define CPUID_EDX_MSR   (1 << 5)
+#define CPUID_EDX_CLFSH (1 << 19)
+#define CPUID_EDX_APIC  (1 << 9)
+#define CPUID_EDX_FXSR  (1 << 24)
+#define CPUID_EDX_SSE   (1 << 25)
+#define CPUID_EDX_HTT   (1 << 28)
+#define CPUID_ECX_TSC_DEADLINE (1 << 24)
+#define CPUID_ECX_XSAVE (1 << 26)
+
+struct CpuInfo {
+    char vendor[13];
+    uint32_t family;
+    uint32_t model;
+    uint32_t max_leaf;
+    uint32_t features_ecx;   // CPUID.01H:ECX
+    uint32_t features_edx;   // CPUID.01H:EDX
+    uint32_t tsc_khz;        // Calibrated TSC frequency, 0 if unknown
+};
+
+extern CpuInfo cpu_info;
+
+void cpu_detect();
+
+static inline bool cpu_has(uint32_t edx_bit) { return (cpu_info.features_edx & edx_bit) != 0; }
+static inline bool cpu_has_ecx(uint32_t ecx_bit) { return (cpu_info.features_ecx & ecx_bit) != 0; }
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    asm volatile("cpuid"
+                 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                 : "a"(leaf), "c"(subleaf));
+}
+
+static inline uint64_t rdtsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+// Evicts the cache line holding addr from every cache level
+static inline void clflush(const volatile void* addr) {
+    asm volatile("clflush (%0)" : : "r"(addr) : "memory");
+}
+
+static inline void mfence() {
+    asm volatile("mfence" : : : "memory");
+}
+
+#define EFLAGS_IF 0x200
+
+#if LATENCY_TRACERS
+// Hooks of IrqsoffTracer (latency.h), only called while it is enabled
+extern volatile bool irqsoff_tracing;
+void irqsoff_begin(uint32_t site);
+void irqsoff_end(uint32_t site);
+#endif
+
+// Address of the code at this spot, inlined copies each get their own
+static inline __attribute__((always_inline)) uint32_t code_site() {
+    uint32_t site;
+    asm volatile("1: movl $1b, %0" : "=r"(site));
+    return site;
+}
+
+// Tell the irqsoff tracer that interrupts were just masked, or are about
+// to be unmasked; always inlined so the recorded site is the caller's
+static inline __attribute__((always_inline)) void trace_irqs_off() {
+#if LATENCY_TRACERS
+    if (irqsoff_tracing) irqsoff_begin(code_site());
+#endif
+}
+
+static inline __attribute__((always_inline)) void trace_irqs_on() {
+#if LATENCY_TRACERS
+    if (irqsoff_tracing) irqsoff_end(code_site());
+#endif
+}
+
+// Disables interrupts and returns the previous EFLAGS for irq_restore.
+// Threads run with IOPL 3, so this also works in ring 3.
+static inline __attribute__((always_inline)) uint32_t irq_save() {
+    uint32_t flags;
+    asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    if (flags & EFLAGS_IF) trace_irqs_off();
+    return flags;
+}
+
+static inline __attribute__((always_inline)) void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) trace_irqs_on();
+    asm volatile("push %0; popf" : : "r"(flags) : "memory", "cc");
+}
+
+static inline __attribute__((always_inline)) void irq_enable() {
+    trace_irqs_on();
+    asm volatile("sti" : : : "memory");
+}
+
+static inline __attribute__((always_inline)) void irq_disable() {
+    asm volatile("cli" : : : "memory");
+    trace_irqs_off();
+}
+
+// CR0.TS makes the next FPU/SSE instruction raise #NM (lazy FPU switching)
+static inline void fpu_set_ts() {
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    asm volatile("mov %0, %%cr0" : : "r"(cr0 | 0x8));
+}
+
+static inline void fpu_clear_ts() {
+    asm volatile("clts");
+}
+
+#endif // CPU_H
@@ -0,0 +1,111 @@
+#include "edf.h"
+#include "process.h"
+#include "percpu.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "logger.h"
+#include "math64.h"
+#include "timer.h"
+
+static TicketLock admission_lock;
+
+// Density in per mille, rounded up so admission stays on the safe side
+static uint32_t density(PCB* pcb) {
+    uint32_t window = pcb->dl_deadline < pcb->dl_period ? pcb->dl_deadline : pcb->dl_period;
+    return (pcb->dl_runtime * 1000 + window - 1) / window;
+}
+
+bool Edf::admit(PCB* pcb, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms) {
+    if (runtime_ms == 0 || runtime_ms > deadline_ms || deadline_ms > period_ms) {
+        Logger::log(LogLevel::ERROR, "EDF: PID %d needs runtime <= deadline <= period", pcb->pid);
+        return false;
+    }
+    if (!cpu_info.tsc_khz) {
+        Logger::log(LogLevel::ERROR, "EDF: budgets need a calibrated TSC");
+        return false;
+    }
+
+    pcb->dl_runtime = runtime_ms;
+    pcb->dl_deadline = deadline_ms;
+    pcb->dl_period = period_ms;
+    uint32_t needed = density(pcb);
+
+    // Worst fit: the least loaded CPU that still has room
+    IrqSaveGuard<TicketLock> guard(admission_lock);
+    PerCpu* best = nullptr;
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        PerCpu* cpu = &cpus[i];
+        if (!cpu->online || cpu->dl_bandwidth + needed > EDF_BANDWIDTH_LIMIT) continue;
+        if (!best || cpu->dl_bandwidth < best->dl_bandwidth) best = cpu;
+    }
+    if (!best) return false;
+
+    best->dl_bandwidth += needed;
+    pcb->affinity = best->id;
+    pcb->dl_misses = 0;
+    start_job(pcb, get_current_time_ms());
+    return true;
+}
+
+void Edf::leave(PCB* pcb) {
+    IrqSaveGuard<TicketLock> guard(admission_lock);
+    cpus[pcb->affinity].dl_bandwidth -= density(pcb);
+    pcb->affinity = CPU_ANY;
+}
+
+bool Edf::earlier(PCB* a, PCB* b) {
+    return (int32_t)(a->dl_abs_deadline - b->dl_abs_deadline) < 0;
+}
+
+void Edf::start_job(PCB* pcb, uint32_t release) {
+    pcb->dl_release = release;
+    pcb->dl_abs_deadline = release + pcb->dl_deadline;
+    pcb->dl_budget = (int64_t)pcb->dl_runtime * cpu_info.tsc_khz;
+    pcb->dl_missed = false;
+}
+
+void Edf::replenish(PCB* pcb, uint32_t now) {
+    pcb->dl_abs_deadline = now + pcb->dl_deadline;
+    pcb->dl_budget = (int64_t)pcb->dl_runtime * cpu_info.tsc_khz;
+}
+
+// Counted once per job
+void Edf::check_miss(PCB* pcb, uint32_t now) {
+    if (!pcb->dl_missed && (int32_t)(now - pcb->dl_abs_deadline) > 0) {
+        pcb->dl_missed = true;
+        pcb->dl_misses++;
+    }
+}
+
+bool Edf::charge(PCB* pcb, uint64_t now_tsc, uint32_t now) {
+    pcb->dl_budget -= (int64_t)(now_tsc - pcb->exec_start);
+    pcb->exec_start = now_tsc;
+    check_miss(pcb, now);
+    return pcb->dl_budget <= 0;
+}
+
+uint32_t Edf::finish_job(PCB* pcb, uint32_t now) {
+    check_miss(pcb, now);
+
+    // An overrunning job starts the next one right away instead of
+    // owing the periods it missed
+    uint32_t release = pcb->dl_release + pcb->dl_period;
+    if ((int32_t)(release - now) < 0) release = now;
+    start_job(pcb, release);
+    return release;
+}
+
+void Edf::wake(PCB* pcb, uint32_t now) {
+    if (pcb->policy != SCHED_DEADLINE) return;
+
+    if (pcb->dl_budget <= 0 || (int32_t)(now - pcb->dl_abs_deadline) >= 0) {
+        check_miss(pcb, now);
+        replenish(pcb, now);
+    }
+}
+
+uint32_t Edf::slice_ms(PCB* pcb) {
+    if (pcb->dl_budget <= 0) return 1;
+    uint32_t ms = (uint32_t)div64((uint64_t)pcb->dl_budget + cpu_info.tsc_khz - 1, cpu_info.tsc_khz);
+    return ms ? ms : 1;
+}
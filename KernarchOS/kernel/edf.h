@@ -0,0 +1,48 @@
+#ifndef EDF_H
+#define EDF_H
+
+#include "types.h"
+
+// Deadline class: a thread reserves runtime_ms of CPU every period_ms,
+// each job due deadline_ms after its release. Ready deadline threads run
+// before everything else, earliest absolute deadline first. Admission is
+// per CPU (the thread is pinned to the CPU that admitted it), so plain
+// EDF on each CPU meets every deadline while the density sum stays at 1.
+#define EDF_BANDWIDTH_LIMIT 900  // Per mille of each CPU deadline threads may reserve
+
+struct PCB;
+
+class Edf {
+public:
+    // Admission control, on success the thread is pinned and its first
+    // job starts now. Fails if no CPU has the bandwidth left.
+    static bool admit(PCB* pcb, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms);
+
+    // Returns the thread's bandwidth, on exit or class change
+    static void leave(PCB* pcb);
+
+    // Charges the cycles run since pcb->exec_start; true once the job has
+    // used up its budget and has to be throttled until its deadline
+    static bool charge(PCB* pcb, uint64_t now_tsc, uint32_t now);
+
+    // Ends the current job and sets up the next one, returns its release time
+    static uint32_t finish_job(PCB* pcb, uint32_t now);
+
+    // Called when the thread becomes runnable. A throttled job, or one
+    // that slept past its deadline, gets a fresh budget and a deadline
+    // postponed from now.
+    static void wake(PCB* pcb, uint32_t now);
+
+    // Timer slice: what is left of the budget, never zero
+    static uint32_t slice_ms(PCB* pcb);
+
+    // Whether a's deadline is earlier than b's
+    static bool earlier(PCB* a, PCB* b);
+
+private:
+    static void start_job(PCB* pcb, uint32_t release);
+    static void replenish(PCB* pcb, uint32_t now);
+    static void check_miss(PCB* pcb, uint32_t now);
+};
+
+#endif // EDF_H
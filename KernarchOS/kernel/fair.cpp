@@ -0,0 +1,44 @@
+#include "fair.h"
+#include "process.h"
+#include "cpu.h"
+#include "math64.h"
+
+// Same curve as Linux: weight(nice) ~ 1024 / 1.25^nice
+static const uint32_t nice_weights[NICE_MAX - NICE_MIN + 1] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+     9548,  7620,  6100,  4904,  3906,
+     3121,  2501,  1991,  1586,  1277,
+     1024,   820,   655,   526,   423,
+      335,   272,   215,   172,   137,
+      110,    87,    70,    56,    45,
+       36,    29,    23,    18,    15,
+};
+
+uint32_t Fair::weight(int32_t nice) {
+    if (nice < NICE_MIN) nice = NICE_MIN;
+    if (nice > NICE_MAX) nice = NICE_MAX;
+    return nice_weights[nice - NICE_MIN];
+}
+
+void Fair::charge(PCB* pcb, uint64_t now_tsc) {
+    uint64_t delta = now_tsc - pcb->exec_start;
+    pcb->exec_start = now_tsc;
+
+    if (pcb->weight == NICE_0_WEIGHT) pcb->vruntime += delta;
+    else pcb->vruntime += div64(delta * NICE_0_WEIGHT, pcb->weight);
+}
+
+void Fair::place(PCB* pcb, uint64_t min_vruntime) {
+    uint64_t credit = (uint64_t)(FAIR_LATENCY_MS / 2) * cpu_info.tsc_khz;
+    uint64_t floor = min_vruntime > credit ? min_vruntime - credit : 0;
+    if (pcb->vruntime < floor) pcb->vruntime = floor;
+}
+
+uint32_t Fair::slice_ms(uint32_t weight, uint32_t total_weight, uint32_t runnable) {
+    uint32_t period = FAIR_LATENCY_MS;
+    if (runnable * FAIR_MIN_GRANULARITY_MS > period) period = runnable * FAIR_MIN_GRANULARITY_MS;
+
+    uint32_t slice = total_weight ? (uint32_t)div64((uint64_t)period * weight, total_weight) : period;
+    return slice < FAIR_MIN_GRANULARITY_MS ? FAIR_MIN_GRANULARITY_MS : slice;
+}
@@ -0,0 +1,34 @@
+#ifndef FAIR_H
+#define FAIR_H
+
+#include "types.h"
+
+// Fair-share class, modelled on CFS: every thread accumulates virtual
+// runtime (cycles run scaled by NICE_0_WEIGHT / weight) and the one with
+// the least runs next. Fair threads only run when no MLFQ thread is ready.
+#define FAIR_LATENCY_MS         20  // Every queued fair thread runs once per period
+#define FAIR_MIN_GRANULARITY_MS 2   // Shortest slice, stretches the period when crowded
+
+#define NICE_MIN -20
+#define NICE_MAX 19
+#define NICE_0_WEIGHT 1024
+
+struct PCB;
+
+class Fair {
+public:
+    // Weight of a nice level, each step is about 10% CPU
+    static uint32_t weight(int32_t nice);
+
+    // Adds the cycles run since pcb->exec_start to its virtual runtime
+    static void charge(PCB* pcb, uint64_t now_tsc);
+
+    // Keeps a thread that slept or migrated from hoarding credit: it may
+    // start at most half a latency period behind min_vruntime
+    static void place(PCB* pcb, uint64_t min_vruntime);
+
+    // Share of the latency period for a thread of the given weight
+    static uint32_t slice_ms(uint32_t weight, uint32_t total_weight, uint32_t runnable);
+};
+
+#endif // FAIR_H
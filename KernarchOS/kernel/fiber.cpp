@@ -0,0 +1,226 @@
+#include "fiber.h"
+#include "thread.h"
+#include "process.h"
+#include "waitqueue.h"
+#include "tls.h"
+#include "memory.h"
+#include "cstring.h"
+#include "logger.h"
+
+// A carrier's scheduling state. The context that switches away leaves
+// what still has to happen to it here, and the context switched to does
+// it first thing, once the old stack is no longer in use.
+struct FiberCarrier {
+    uint32_t esp;            // Its loop, saved while a fiber runs
+    Fiber* current;          // nullptr while in the loop
+    Thread* thread;
+    Fiber* requeue;          // Yielded, still runnable
+    Fiber* dead;             // Finished, its stack can be reused
+    Spinlock* unlock;        // Parked with this lock held
+    uint32_t unlock_flags;
+    uint32_t switches;
+};
+
+static FiberCarrier carriers[FIBER_CARRIERS_MAX];
+static uint32_t carrier_count;
+static ThreadLocal<FiberCarrier*> this_carrier;
+
+// Idle carriers wait here, its lock guards the run queue and the cache
+static WaitQueue runnable;
+static FiberQueue run_queue;
+static Fiber* free_fibers;
+static volatile bool stopping;
+
+// stop() waits here for the last fiber
+static WaitQueue finished;
+
+uint32_t Fibers::live_count;
+
+bool Fibers::start(uint32_t count) {
+    if (carrier_count) return false;
+    if (count == 0) count = 1;
+    if (count > FIBER_CARRIERS_MAX) count = FIBER_CARRIERS_MAX;
+
+    stopping = false;
+    for (uint32_t i = 0; i < count; i++) {
+        FiberCarrier* carrier = &carriers[i];
+        memset(carrier, 0, sizeof(FiberCarrier));
+        Thread* thread = ThreadManager::create_thread(carrier_main, (const char*)carrier, false);
+        if (!thread) break;
+        ThreadManager::set_joinable(thread);
+        carrier->thread = thread;
+        carrier_count++;
+        wake_process(thread);
+    }
+    return carrier_count != 0;
+}
+
+// Fibers that never finish, such as one parked on a channel nobody
+// sends to, keep this waiting
+void Fibers::stop() {
+    finished.wait_until([] { return live_count == 0; });
+
+    uint32_t flags = runnable.lock_irqsave();
+    stopping = true;
+    runnable.unlock_irqrestore(flags);
+    runnable.wake_all();
+
+    for (uint32_t i = 0; i < carrier_count; i++) ThreadManager::join(carriers[i].thread);
+    carrier_count = 0;
+
+    while (Fiber* fiber = free_fibers) {
+        free_fibers = fiber->next;
+        kfree(fiber->stack);
+        delete fiber;
+    }
+}
+
+Fiber* Fibers::spawn(void (*entry)(void*), void* arg) {
+    uint32_t flags = runnable.lock_irqsave();
+    Fiber* fiber = free_fibers;
+    if (fiber) free_fibers = fiber->next;
+    runnable.unlock_irqrestore(flags);
+
+    if (!fiber) {
+        fiber = new Fiber();
+        uint8_t* stack = fiber ? (uint8_t*)kmalloc(FIBER_STACK_SIZE) : nullptr;
+        if (!stack) {
+            delete fiber;
+            Logger::log(LogLevel::ERROR, "Failed to allocate a fiber");
+            return nullptr;
+        }
+        fiber->stack = stack;
+    }
+    fiber->entry = entry;
+    fiber->arg = arg;
+    fiber->slot = nullptr;
+
+    // The first switch to it returns into fiber_start(fiber), which gets
+    // a 16-byte aligned argument like any other call
+    uint32_t* sp = (uint32_t*)(((uint32_t)fiber->stack + FIBER_STACK_SIZE) & ~15u);
+    sp -= 3;                            // Padding
+    *--sp = (uint32_t)fiber;
+    *--sp = 0;                          // Return address, fiber_start never returns
+    *--sp = (uint32_t)fiber_start;
+    *--sp = 0;                          // EBP
+    *--sp = 0;                          // EBX
+    *--sp = 0;                          // ESI
+    *--sp = 0;                          // EDI
+    fiber->esp = (uint32_t)sp;
+
+    __atomic_add_fetch(&live_count, 1, __ATOMIC_RELAXED);
+    ready(fiber);
+    return fiber;
+}
+
+void Fibers::ready(Fiber* fiber) {
+    uint32_t flags = runnable.lock_irqsave();
+    run_queue.push(fiber);
+    runnable.wake_one_locked();
+    runnable.unlock_irqrestore(flags);
+}
+
+Fiber* Fibers::current() {
+    FiberCarrier* carrier = *this_carrier;
+    return carrier ? carrier->current : nullptr;
+}
+
+uint32_t Fibers::switches() {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < FIBER_CARRIERS_MAX; i++) total += carriers[i].switches;
+    return total;
+}
+
+void Fibers::yield() {
+    FiberCarrier* carrier = *this_carrier;
+    Fiber* self = carrier ? carrier->current : nullptr;
+    if (!self) return;
+
+    uint32_t flags = runnable.lock_irqsave();
+    Fiber* next = run_queue.pop();
+    runnable.unlock_irqrestore(flags);
+    if (!next) return;
+
+    carrier->requeue = self;
+    carrier->current = next;
+    carrier->switches++;
+    switch_stacks(&self->esp, next->esp);
+    finish_switch();
+}
+
+void Fibers::park(Spinlock* lock, uint32_t flags) {
+    FiberCarrier* carrier = *this_carrier;
+    carrier->unlock = lock;
+    carrier->unlock_flags = flags;
+    switch_away(carrier->current);
+}
+
+// Runs the next runnable fiber, or the carrier's loop if there is none
+void Fibers::switch_away(Fiber* self) {
+    FiberCarrier* carrier = *this_carrier;
+    uint32_t flags = runnable.lock_irqsave();
+    Fiber* next = run_queue.pop();
+    runnable.unlock_irqrestore(flags);
+
+    carrier->current = next;
+    carrier->switches++;
+    switch_stacks(&self->esp, next ? next->esp : carrier->esp);
+    finish_switch();
+}
+
+// May run on another carrier than the one the switch started on, every
+// context that was switched to calls it first
+void Fibers::finish_switch() {
+    FiberCarrier* carrier = *this_carrier;
+
+    if (Fiber* fiber = carrier->requeue) {
+        carrier->requeue = nullptr;
+        ready(fiber);
+    }
+    if (Spinlock* lock = carrier->unlock) {
+        carrier->unlock = nullptr;
+        lock->unlock_irqrestore(carrier->unlock_flags);
+    }
+    if (Fiber* fiber = carrier->dead) {
+        carrier->dead = nullptr;
+        uint32_t flags = runnable.lock_irqsave();
+        fiber->next = free_fibers;
+        free_fibers = fiber;
+        runnable.unlock_irqrestore(flags);
+
+        flags = finished.lock_irqsave();
+        bool last = --live_count == 0;
+        finished.unlock_irqrestore(flags);
+        if (last) finished.wake_all();
+    }
+}
+
+void Fibers::fiber_start(Fiber* fiber) {
+    finish_switch();
+    fiber->entry(fiber->arg);
+
+    FiberCarrier* carrier = *this_carrier;
+    carrier->dead = fiber;
+    switch_away(fiber);
+}
+
+// Runs fibers until stop(), sleeping in the kernel whenever none is runnable
+void Fibers::carrier_main(const char* arg) {
+    FiberCarrier* carrier = (FiberCarrier*)arg;
+    *this_carrier = carrier;
+    ThreadManager::get_current_thread()->fiber_carrier = true;
+
+    while (true) {
+        Fiber* next = nullptr;
+        runnable.wait_until([&] {
+            next = run_queue.pop();
+            return next || stopping;
+        });
+        if (!next) return;
+
+        carrier->current = next;
+        carrier->switches++;
+        switch_stacks(&carrier->esp, next->esp);
+        finish_switch();
+    }
+}
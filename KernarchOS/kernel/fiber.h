@@ -0,0 +1,144 @@
+#ifndef FIBER_H
+#define FIBER_H
+
+#include "types.h"
+#include "spinlock.h"
+
+#define FIBER_STACK_SIZE 8192
+#define FIBER_CARRIERS_MAX 4
+
+// A cooperatively scheduled user-level thread. Fibers are multiplexed
+// over a few kernel threads, the carriers, and switch between each other
+// with switch_stacks, the same few instructions the kernel uses between
+// kernel stacks, without a system call or the kernel scheduler. A
+// carrier only blocks in the kernel when no fiber is runnable, or when
+// the fiber it runs makes a blocking call such as sys_read.
+//
+// Fibers share their carrier's TLS block and FPU control words, and a
+// fiber may resume on a different carrier than the one it left.
+struct Fiber {
+    uint32_t esp;                // Saved while switched out
+    void (*entry)(void*);
+    void* arg;
+    Fiber* next;                 // Run queue or wait list link
+    uint8_t* stack;
+    void* slot;                  // Where a channel hands over a value
+};
+
+// FIFO of fibers, guarded by whoever owns it
+struct FiberQueue {
+    Fiber* head;
+    Fiber* tail;
+
+    void push(Fiber* fiber) {
+        fiber->next = nullptr;
+        if (tail) tail->next = fiber;
+        else head = fiber;
+        tail = fiber;
+    }
+
+    Fiber* pop() {
+        Fiber* fiber = head;
+        if (fiber) {
+            head = fiber->next;
+            if (!head) tail = nullptr;
+        }
+        return fiber;
+    }
+};
+
+class Fibers {
+public:
+    // Starts the carrier threads, false if they are already running
+    static bool start(uint32_t carriers);
+    // Waits for every fiber to finish, then stops the carriers
+    static void stop();
+
+    // Queues a new fiber, from a fiber or from any thread
+    static Fiber* spawn(void (*entry)(void*), void* arg);
+
+    // Lets the other runnable fibers go first, from a fiber
+    static void yield();
+
+    // From a fiber, with lock held through lock_irqsave: switches away
+    // and releases the lock once its context is saved. It runs again
+    // after someone passes it to ready.
+    static void park(Spinlock* lock, uint32_t flags);
+    static void ready(Fiber* fiber);
+
+    static Fiber* current();
+    static uint32_t live() { return live_count; }
+    static uint32_t switches();
+
+private:
+    static void carrier_main(const char* arg);
+    static void fiber_start(Fiber* fiber);
+    static void switch_away(Fiber* self);
+    static void finish_switch();
+
+    static uint32_t live_count;     // Spawned and not yet finished
+};
+
+// Bounded channel between fibers, N slots. send blocks the fiber while
+// the channel is full and recv while it is empty; a value goes straight
+// to a waiting receiver without passing through the buffer.
+template<typename T, uint32_t N>
+class Channel {
+    static_assert(N > 0, "a channel needs at least one slot");
+
+public:
+    void send(const T& value) {
+        uint32_t flags = lock.lock_irqsave();
+        if (Fiber* receiver = receivers.pop()) {
+            *(T*)receiver->slot = value;
+            Fibers::ready(receiver);
+            lock.unlock_irqrestore(flags);
+            return;
+        }
+        if (count < N) {
+            buffer[(head + count++) % N] = value;
+            lock.unlock_irqrestore(flags);
+            return;
+        }
+
+        // Full: a receiver takes the value from here and readies us
+        Fiber* self = Fibers::current();
+        self->slot = (void*)&value;
+        senders.push(self);
+        Fibers::park(&lock, flags);
+    }
+
+    T recv() {
+        T value;
+        uint32_t flags = lock.lock_irqsave();
+        if (count) {
+            value = buffer[head];
+            head = (head + 1) % N;
+            count--;
+            // Room again for the oldest blocked sender
+            if (Fiber* sender = senders.pop()) {
+                buffer[(head + count++) % N] = *(const T*)sender->slot;
+                Fibers::ready(sender);
+            }
+            lock.unlock_irqrestore(flags);
+            return value;
+        }
+
+        // Empty: a sender writes straight into value and readies us
+        Fiber* self = Fibers::current();
+        self->slot = &value;
+        receivers.push(self);
+        Fibers::park(&lock, flags);
+        return value;
+    }
+
+private:
+    Spinlock lock;
+    FiberQueue senders;
+    FiberQueue receivers;
+    uint32_t head;
+    uint32_t count;
+    T buffer[N];
+};
+
+#endif // FIBER_H
@@ -0,0 +1,187 @@
+#include "fpu.h"
+#include "cpu.h"
+#include "process.h"
+#include "memory.h"
+#include "cstring.h"
+#include "logger.h"
+#include "kernel_config.h"
+
+#define FPU_STATE_ALIGN 64
+#define FXSAVE_AREA_SIZE 512
+
+// XCR0 components saved for threads
+#define XCR0_X87 (1 << 0)
+#define XCR0_SSE (1 << 1)
+#define CR4_OSXSAVE (1 << 18)
+
+static FpuMode fpu_mode = FPU_DEFAULT_MODE;
+static FpuSaveMethod save_method = FPU_SAVE_FXSAVE;
+static uint32_t state_size = FXSAVE_AREA_SIZE;
+static uint32_t xsave_mask = 0;
+
+static FpuStats stats;
+
+static const char* mode_names[] = { "lazy", "eager" };
+static const char* save_method_names[] = { "FXSAVE", "XSAVE", "XSAVEOPT" };
+
+static void fpu_save(PCB* pcb) {
+    switch (save_method) {
+        case FPU_SAVE_XSAVEOPT:
+            asm volatile("xsaveopt (%0)" : : "r"(pcb->fpu_state), "a"(xsave_mask), "d"(0) : "memory");
+            break;
+        case FPU_SAVE_XSAVE:
+            asm volatile("xsave (%0)" : : "r"(pcb->fpu_state), "a"(xsave_mask), "d"(0) : "memory");
+            break;
+        default:
+            asm volatile("fxsave (%0)" : : "r"(pcb->fpu_state) : "memory");
+            break;
+    }
+    stats.saves++;
+}
+
+static void fpu_restore(PCB* pcb) {
+    if (save_method == FPU_SAVE_FXSAVE) {
+        asm volatile("fxrstor (%0)" : : "r"(pcb->fpu_state) : "memory");
+    } else {
+        asm volatile("xrstor (%0)" : : "r"(pcb->fpu_state), "a"(xsave_mask), "d"(0) : "memory");
+    }
+    stats.restores++;
+}
+
+static bool fpu_ts_set() {
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    return (cr0 & 0x8) != 0;
+}
+
+// The registers of this CPU still hold pcb's state: it was loaded here
+// last and nobody else used this FPU since
+static bool fpu_regs_valid(PerCpu* cpu, PCB* pcb) {
+    return cpu->fpu_owner == pcb && pcb->fpu_cpu == cpu->id;
+}
+
+// Hands this CPU's FPU registers to pcb
+static void fpu_load(PerCpu* cpu, PCB* pcb) {
+    if (!pcb) return;
+    if (!fpu_regs_valid(cpu, pcb) && pcb->fpu_state) fpu_restore(pcb);
+    cpu->fpu_owner = pcb;
+    pcb->fpu_cpu = cpu->id;
+}
+
+void fpu_init_cpu() {
+    if (!xsave_mask) return;
+
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    asm volatile("mov %0, %%cr4" : : "r"(cr4 | CR4_OSXSAVE));
+    asm volatile("xsetbv" : : "c"(0), "a"(xsave_mask), "d"(0));
+}
+
+void fpu_init() {
+    if (cpu_has_ecx(CPUID_ECX_XSAVE) && cpu_info.max_leaf >= 0xD) {
+        uint32_t eax, ebx, ecx, edx;
+        cpuid(0xD, 0, &eax, &ebx, &ecx, &edx);
+        xsave_mask = eax & (XCR0_X87 | XCR0_SSE);
+        fpu_init_cpu();
+
+        // EBX reports the area size for the components enabled in XCR0
+        cpuid(0xD, 0, &eax, &ebx, &ecx, &edx);
+        state_size = ebx;
+
+        cpuid(0xD, 1, &eax, &ebx, &ecx, &edx);
+        save_method = (eax & 0x1) ? FPU_SAVE_XSAVEOPT : FPU_SAVE_XSAVE;
+    }
+
+    Logger::log(LogLevel::INFO, "FPU: %s switching with %s, %d byte state",
+                fpu_mode_name(), fpu_save_method_name(), state_size);
+}
+
+void fpu_init_state(uint8_t* state) {
+    // Default control words; an all-zero XSAVE header means init state for the rest
+    memset(state, 0, state_size);
+    *(uint16_t*)(state + 0) = 0x37F;    // FCW: all x87 exceptions masked
+    *(uint32_t*)(state + 24) = 0x1F80;  // MXCSR: all SSE exceptions masked
+}
+
+uint8_t* fpu_alloc_state() {
+    uint8_t* state = (uint8_t*)aligned_kmalloc(FPU_STATE_ALIGN, state_size);
+    if (!state) {
+        Logger::log(LogLevel::ERROR, "Failed to allocate FPU state");
+        return nullptr;
+    }
+    fpu_init_state(state);
+    return state;
+}
+
+void fpu_disown(PCB* pcb) {
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        if (cpus[i].fpu_owner == pcb) cpus[i].fpu_owner = nullptr;
+    }
+}
+
+void fpu_release(PCB* pcb) {
+    if (!pcb) return;
+    fpu_disown(pcb);
+    if (pcb->fpu_state) {
+        aligned_kfree(pcb->fpu_state);
+        pcb->fpu_state = nullptr;
+    }
+}
+
+void fpu_switch(PCB* prev, PCB* next) {
+    PerCpu* cpu = this_cpu();
+    stats.switches++;
+
+    // prev may resume on another CPU, so state it could have changed this
+    // slice (TS clear) is written back now; lazy mode only defers the restore
+    if (prev && cpu->fpu_owner == prev && prev->fpu_state && !fpu_ts_set()) {
+        fpu_save(prev);
+    }
+
+    if (fpu_mode == FPU_EAGER || fpu_regs_valid(cpu, next)) {
+        fpu_clear_ts();
+        fpu_load(cpu, next);
+    } else {
+        fpu_set_ts();
+    }
+}
+
+// #NM: the current thread touched the FPU while CR0.TS was set
+void fpu_handle_trap(interrupt_frame* frame) {
+    fpu_clear_ts();
+
+    if ((frame->cs & 3) == 0) stats.kernel_traps++;
+    else stats.traps++;
+
+    // Kernel code runs on behalf of the current thread and uses its state
+    fpu_load(this_cpu(), current_process);
+}
+
+void fpu_set_mode(FpuMode mode) {
+    // Both modes save on switch-out, so the change takes effect at the next dispatch
+    fpu_mode = mode;
+}
+
+FpuMode fpu_get_mode() {
+    return fpu_mode;
+}
+
+const char* fpu_mode_name() {
+    return mode_names[fpu_mode];
+}
+
+const char* fpu_save_method_name() {
+    return save_method_names[save_method];
+}
+
+uint32_t fpu_state_size() {
+    return state_size;
+}
+
+const FpuStats* fpu_get_stats() {
+    return &stats;
+}
+
+void fpu_reset_stats() {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,55 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include "types.h"
+#include "isr.h"
+
+struct PCB;
+
+// PCB::fpu_cpu before the state was ever loaded
+#define FPU_NO_CPU 0xFFFFFFFF
+
+enum FpuMode {
+    FPU_LAZY,   // Set CR0.TS on switch, move state on the first #NM
+    FPU_EAGER   // Save and restore on every switch, never trap
+};
+
+// Save/restore instructions picked from CPUID at boot
+enum FpuSaveMethod {
+    FPU_SAVE_FXSAVE,
+    FPU_SAVE_XSAVE,
+    FPU_SAVE_XSAVEOPT
+};
+
+struct FpuStats {
+    uint32_t switches;       // fpu_switch calls
+    uint32_t traps;          // #NM from threads
+    uint32_t kernel_traps;   // #NM raised by kernel code (built with -msse)
+    uint32_t saves;
+    uint32_t restores;
+};
+
+void fpu_init();
+void fpu_init_cpu();  // XSAVE setup on an application processor
+
+uint8_t* fpu_alloc_state();
+// Resets a state area to what fpu_alloc_state returns
+void fpu_init_state(uint8_t* state);
+// No CPU keeps the process's registers live any more
+void fpu_disown(PCB* pcb);
+void fpu_release(PCB* pcb);
+
+// Scheduler hook, called right before switching from prev to next
+void fpu_switch(PCB* prev, PCB* next);
+void fpu_handle_trap(interrupt_frame* frame);
+
+void fpu_set_mode(FpuMode mode);
+FpuMode fpu_get_mode();
+const char* fpu_mode_name();
+const char* fpu_save_method_name();
+uint32_t fpu_state_size();
+
+const FpuStats* fpu_get_stats();
+void fpu_reset_stats();
+
+#endif // FPU_H
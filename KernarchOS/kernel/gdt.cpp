@@ -1,6 +1,6 @@
 #include "gdt.h"
 
-extern "C" GDTEntry gdt_entries[GDT_ENTRIES];
+GDTEntry gdt_entries[GDT_ENTRIES];
 
 void gdt_set_gate(int32_t num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
     gdt_entries[num].base_low    = (base & 0xFFFF);
@@ -2,6 +2,7 @@
 #define GDT_H
 
 #include "types.h"
+#include "kernel_config.h"
 
 // GDT entry structure
 struct GDTEntry {
@@ -19,7 +20,12 @@ struct GDTPointer {
     uint32_t base;
 } __attribute__((packed));
 
-#define GDT_ENTRIES 6
+// Null, kernel code/data, user code/data, then a TSS, a per-CPU data and
+// a thread-local storage descriptor for every CPU
+#define GDT_ENTRIES (5 + 3 * MAX_CPUS)
+#define GDT_TSS_ENTRY(cpu) (5 + 3 * (cpu))
+#define GDT_PERCPU_ENTRY(cpu) (6 + 3 * (cpu))
+#define GDT_TLS_ENTRY(cpu) (7 + 3 * (cpu))
 
 // GDT segment selectors
 #define KERNEL_CODE_SEG 0x08
@@ -27,6 +33,9 @@ struct GDTPointer {
 #define USER_CODE_SEG (0x18 | 3)  // Ring 3
 #define USER_DATA_SEG (0x20 | 3)  // Ring 3
 #define TSS_SEG 0x28
+#define TSS_SEG_CPU(cpu) (GDT_TSS_ENTRY(cpu) * 8)
+#define PERCPU_SEG(cpu) ((GDT_PERCPU_ENTRY(cpu) * 8) | 3)  // Loaded in GS, ring 3 keeps it too
+#define TLS_SEG(cpu) ((GDT_TLS_ENTRY(cpu) * 8) | 3)        // Loaded in FS, based at the running thread's block
 
 // Declare gdt_entries as extern
 extern "C" {
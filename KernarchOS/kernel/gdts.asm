@@ -7,11 +7,6 @@ TSS_SEG equ 0x28
 
 ; Export symbols for use in C code
 global gdt_flush
-global gdt_entries
-
-section .data
-gdt_entries:
-    times 6*8 db 0  ; Reserve space for 6 GDT entries (8 bytes each)
 
 section .text
 ; Function to load the GDT
@@ -1,4 +1,7 @@
 section .text
+
+PERCPU_SEG_OFFSET equ 8 | 3 ; From TSS_SEG_CPU to PERCPU_SEG, see gdt.h
+
 %macro int_vector_macro 1
   int_vector_handler_%1:
   cli
@@ -13,6 +16,11 @@ section .text
   push fs
   push gs
 
+  ; Per-CPU data: this CPU's GS descriptor follows its TSS descriptor
+  str ax
+  add ax, PERCPU_SEG_OFFSET
+  mov gs, ax
+
   push esp
   cld
   push %1
@@ -33,14 +41,17 @@ int_vector_handler_255:
   jmp null_loop
   iret
 
+global interrupt_return
+
 interrupt_common:
   call isr_handler
 
+; New threads start here with a prepared frame on their kernel stack
+interrupt_return:
   add esp, 4 ; pop %1
   pop esp
 
-  pop gs
-  pop fs
+  add esp, 8 ; Keep this CPU's GS and FS, the saved ones are stale once a thread migrates
   pop es
   pop ds
 
@@ -37,10 +37,8 @@ void syscall_handler(interrupt_frame* frame) {
             term_printf(call_params->params->str);
             break;
         case SYSCALL_READ:
-            if(Keyboard::has_char())
-                call_params->return_value.c = Keyboard::get_char();
-            else
-                call_params->return_value.c = '\0';
+            call_params->return_value.u = Keyboard::read((char*)call_params->params[0].ptr, call_params->params[1].u,
+                                                         call_params->params[2].b, frame);
             break;
         case SYSCALL_CLEAR:
             term_clear();
@@ -49,13 +47,17 @@ void syscall_handler(interrupt_frame* frame) {
             term_printf("Process exited with code: %d\n", (int)call_params->params->u);
             break;
         case SYSCALL_SLEEP:
-            if (!current_process) return;
-            thread = (Thread*)current_process->user_data;
-            if (!thread) return;
-            thread->state = THREAD_SLEEPING;
-            thread->wake_time = get_current_time_ms() + call_params->params->u;
+            if (!ThreadManager::get_current_thread()) return;
+            ThreadManager::sleep_current(call_params->params->u);
             schedule(frame);
             break;
+        case SYSCALL_SPAWN:
+            thread = ThreadManager::create_thread((void(*)(const char*))call_params->params[0].ptr, call_params->params[1].str);
+            call_params->return_value.i = thread ? (int32_t)thread->pid : -1;
+            break;
+        case SYSCALL_WAIT_PERIOD:
+            wait_next_period(frame);
+            break;
         case SYSCALL_TEST:
             ThreadManager::create_thread(testThread, "Test1");
             ThreadManager::create_thread(testThread, "Test2");
@@ -129,15 +131,22 @@ void sys_printf(const char* format, ...) {
     _syscall(&params);
 }
 
-char sys_read() {
+uint32_t sys_read(char* buffer, uint32_t length, bool block) {
     SyscallParams params = {
         .syscall_num = SYSCALL_READ,
-        .param_count = 0
+        .param_count = 3,
+        .params = {{ .ptr = buffer }, { .u = length }, { .b = block }}
     };
 
     _syscall(&params);
 
-    return params.return_value.c;
+    return params.return_value.u;
+}
+
+char sys_read() {
+    char c = '\0';
+    sys_read(&c, 1);
+    return c;
 }
 
 void sys_clear() {
@@ -168,6 +177,27 @@ void sys_test() {
     _syscall(&params);
 }
 
+int32_t sys_spawn(void (*entry_point)(const char*), const char* arg) {
+    SyscallParams params = {
+        .syscall_num = SYSCALL_SPAWN,
+        .param_count = 2,
+        .params = {{ .ptr = (void*)entry_point }, { .str = arg }}
+    };
+
+    _syscall(&params);
+
+    return params.return_value.i;
+}
+
+void sys_wait_period() {
+    SyscallParams params = {
+        .syscall_num = SYSCALL_WAIT_PERIOD,
+        .param_count = 0
+    };
+
+    _syscall(&params);
+}
+
 //Temporary test processes
 void testThread(const char* name) {
     sys_printf("&eStarting %s Process Async Counting =>\n", name);
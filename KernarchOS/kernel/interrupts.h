@@ -2,7 +2,7 @@
 #define INTERRUPTS_H
 
 #include "isr.h"
-#include "pit.h"
+#include "timer.h"
 #include "types.h"
 
 // Define the system call interrupt number
@@ -16,16 +16,22 @@ enum SoftwareInterrupt {
     SYSCALL_CLEAR,
     SYSCALL_EXIT,
     SYSCALL_SLEEP,
-    SYSCALL_TEST
+    SYSCALL_TEST,
+    SYSCALL_SPAWN,
+    SYSCALL_WAIT_PERIOD
 };
 
 // Function prototype for printf system call
 void sys_schedule();
 void sys_printf(const char* format, ...);
-char sys_read();
+// Reads up to length keys, sleeping until at least one arrives unless block is false
+uint32_t sys_read(char* buffer, uint32_t length, bool block = true);
+char sys_read(); // One key, blocks
 void sys_clear();
 void sys_sleep(uint32_t milliseconds);
 void sys_test();
+int32_t sys_spawn(void (*entry_point)(const char*), const char* arg = nullptr);
+void sys_wait_period(); // Deadline threads: end this job, sleep until the next release
 
 void testThread(const char* name);
 
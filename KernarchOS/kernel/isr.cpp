@@ -8,9 +8,13 @@
 #include "kernel_config.h"
 #include "io.h"
 #include "string_utils.h"
+#include "percpu.h"
 #include "types.h"
 #include "process.h"
 #include "memory.h"
+#include "fpu.h"
+#include "softirq.h"
+#include "cpu.h"
 
 static interrupt_handler_t handlers[256][MAX_HANDLERS_PER_INTERRUPT];
 static uint8_t handler_counts[256];
@@ -38,64 +42,11 @@ static interrupt_type_t get_interrupt_type(uint8_t vector) {
     return INTERRUPT_TYPE_UNKNOWN;
 }
 
-void save_fpu_state(PCB* pcb) {
-    if (!pcb || !pcb->fpu_state) return;
-    __asm__ volatile ("fxsave (%0)" : : "r"(pcb->fpu_state) : "memory");
-}
-
-void restore_fpu_state(PCB* pcb) {
-    if (!pcb || !pcb->fpu_state) return;
-    __asm__ volatile ("fxrstor (%0)" : : "r"(pcb->fpu_state) : "memory");
-}
-
-// Initialize FPU state for a process
-void init_fpu_state(PCB* pcb) {
-    if (!pcb || pcb->fpu_state) return;  // Already initialized
-    
-    // Allocate aligned memory for FPU state
-    pcb->fpu_state = (uint8_t*)aligned_kmalloc(16, 512);
-    if (!pcb->fpu_state) {
-        term_printf("Failed to allocate FPU state memory\n");
-        return;
-    }
-    // Clear the FPU state memory
-    memset(pcb->fpu_state, 0, 512);
-    
-    term_printf("FPU initialized for process %d\n", pcb->pid);
-}
-
-PCB* last_fpu_owner = nullptr;
-
 static void handle_exception(uint8_t vector, interrupt_frame* frame) {
     switch (vector) 
     {
     case EXC_DEVICE_NOT_AVAILABLE:
-        if (!current_process) {
-            term_printf("No current process in FPU handler!\n");
-            break;
-        }
-        // Clear TS flag first
-        __asm__ volatile ("clts");
-        // Initialize process FPU state if needed
-        if (!current_process->fpu_state) {
-            init_fpu_state(current_process);
-        }
-        // Only save and restore if the last FPU owner is different
-        if (last_fpu_owner != current_process) {
-            // Save previous FPU state if necessary
-            if (last_fpu_owner != nullptr) {
-                save_fpu_state(last_fpu_owner);
-            }
-
-            // Restore current process FPU state
-            restore_fpu_state(current_process);
-            term_printf("FPU state switched from process %d to %d\n", 
-                       last_fpu_owner ? last_fpu_owner->pid : -1, 
-                       current_process->pid);
-            
-            // Update the last FPU owner
-            last_fpu_owner = current_process;
-        }
+        fpu_handle_trap(frame);
         break;
     case EXC_GENERAL_PROTECTION:
         term_printf("&cGeneral Protection Fault. Task crashed: %d\n", current_process->pid);
@@ -110,6 +61,10 @@ static void handle_exception(uint8_t vector, interrupt_frame* frame) {
 }
 
 extern "C" void isr_handler(uint8_t vector, interrupt_frame frame) {
+    // Interrupt gates masked interrupts on entry, iret unmasks them again
+    bool unmasks = frame.eflags & EFLAGS_IF;
+    if (unmasks) trace_irqs_off();
+
     interrupt_type_t type = get_interrupt_type(vector);
     switch (type) {
         case INTERRUPT_TYPE_EXCEPTION:
@@ -118,13 +73,17 @@ extern "C" void isr_handler(uint8_t vector, interrupt_frame frame) {
 
         case INTERRUPT_TYPE_HARDWARE: {
             uint8_t irq = vector - HARDWARE_INT_BASE;
+            // Acknowledge first, handlers such as the timer may switch threads
+            pic_sendEOI(irq);
             // Execute all registered handlers
             for (int i = 0; i < handler_counts[vector]; i++) {
                 if (handlers[vector][i]) {
                     handlers[vector][i](&frame);
                 }
             }
-            pic_sendEOI(irq);
+            // Bottom halves, then a thread they or a handler woke
+            Softirq::run();
+            if (this_cpu()->need_resched) schedule(&frame);
             break;
         }
 
@@ -135,6 +94,8 @@ extern "C" void isr_handler(uint8_t vector, interrupt_frame frame) {
                     handlers[vector][i](&frame);
                 }
             }
+            Softirq::run();
+            if (this_cpu()->need_resched) schedule(&frame);
             break;
 
         case INTERRUPT_TYPE_UNKNOWN:
@@ -142,6 +103,8 @@ extern "C" void isr_handler(uint8_t vector, interrupt_frame frame) {
             print_interrupt_frame(&frame, vector);
             break;
     }
+
+    if (unmasks) trace_irqs_on();
 }
 
 bool register_interrupt_handler(uint8_t vector, interrupt_handler_t handler) {
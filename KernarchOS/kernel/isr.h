@@ -103,6 +103,13 @@ enum HardwareInterrupt {
     INT_SECONDARY_ATA
 };
 
+// Local APIC vectors (spurious vector needs its low nibble set)
+enum ApicInterrupt {
+    INT_APIC_SPURIOUS = 0xEF,
+    INT_APIC_TIMER = 0xF0,
+    INT_IPI_RESCHEDULE = 0xF1
+};
+
 constexpr const char* exception_messages[] = {
     "Division By Zero", "Debug", "Non Maskable Interrupt", "Breakpoint",
     "Into Detected Overflow", "Out of Bounds", "Invalid Opcode", "No Coprocessor",
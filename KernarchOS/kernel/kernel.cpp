@@ -2,7 +2,9 @@
 #include "terminal.h"
 #include "idt.h"
 #include "isr.h"
-#include "pit.h"
+#include "timer.h"
+#include "cpu.h"
+#include "fpu.h"
 #include "pic.h"
 #include "memory.h"
 #include "paging.h"
@@ -15,6 +17,11 @@
 #include "interrupts.h"
 #include "stack.h"
 #include "thread.h"
+#include "percpu.h"
+#include "smp.h"
+#include "reaper.h"
+#include "workqueue.h"
+#include "async.h"
 
 
 // Main Kernel Entry
@@ -34,15 +41,19 @@ extern "C" void kernel_main(multiboot_info_t* mbd, unsigned int magic) {
     Command commands[] = {
         { (void (*)(void*))init_gdt, NULL, NULL, "GDT" },
         { (void (*)(void*))init_tss, NULL, NULL, "TSS" },
+        { (void (*)(void*))percpu_init, NULL, NULL, "Per-CPU data" },
         { (void (*)(void*))idt_init, NULL, NULL, "IDT" },
         { (void (*)(void*))isr_install, NULL, NULL, "ISRs" },
         { (void (*)(void*))pic_init, NULL, NULL, "PIC" },
         { (void (*)(void*))init_paging, NULL, NULL, "Paging" },
         { (void (*)(void*))multiboot_scan, mbd, (void*)magic, "Multiboot" },
         { (void (*)(void*))init_memory, NULL, NULL, "Memory" },
-        { (void (*)(void*))pit_init, (void*)1000, NULL, "PIT" },
+        { (void (*)(void*))cpu_detect, NULL, NULL, "CPU" },
+        { (void (*)(void*))fpu_init, NULL, NULL, "FPU" },
+        { (void (*)(void*))timer_init, (void*)1000, NULL, "Timer" },
         { (void (*)(void*))Commands::initialize, NULL, NULL, "Commands" },
         { (void (*)(void*))init_processes, NULL, NULL, "Processes" },
+        { (void (*)(void*))smp_init, NULL, NULL, "SMP" },
         { (void (*)(void*))Keyboard::init, NULL, NULL, "Keyboard" },
     };
 
@@ -61,8 +72,16 @@ extern "C" void kernel_main(multiboot_info_t* mbd, unsigned int magic) {
         dummy_sleep(100); // Sleep after each command
         Logger::log(LogLevel::DEBUG, "DONE! (%d/%d)", i+1, sizeof(commands) / sizeof(commands[0])); // Log the command execution
     }
-    // Create the terminal thread
-    ThreadManager::create_thread(terminalProcess);
+    Reaper::start();
+    WorkQueue::start();
+    Executor::start();
+
+    // Create the terminal thread, interactive so compute threads cannot starve it
+    Thread* terminalThread = ThreadManager::create_thread(terminalProcess, nullptr, false);
+    if (terminalThread) {
+        set_process_priority(terminalThread, PRIORITY_INTERACTIVE);
+        wake_process(terminalThread);
+    }
     dummy_sleep(100);
     Logger::info("Kernel initialization complete");
 
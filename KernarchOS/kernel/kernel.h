@@ -23,11 +23,12 @@ void dummy_sleep(int mul){
 }
 
 void terminalProcess(){
+    char input[16];
     while (true) {
-        char c = sys_read();
-        if (c != '\0')
-            term_input(c);
-        thread_sleep(10);
+        // Sleeps until the keyboard interrupt has something
+        uint32_t count = sys_read(input, sizeof(input));
+        for (uint32_t i = 0; i < count; i++)
+            term_input(input[i]);
     }
 }
 
@@ -8,6 +8,40 @@
 
 #define PAGE_SIZE 4096
 
+// Stop the periodic timer tick while only the idle task is runnable
+#define TICKLESS_IDLE 1
+
+// Drive the scheduler from the local APIC timer when present (PIT otherwise)
+#define APIC_TIMER 1
+
+// Switch threads by swapping kernel stacks. 0 brings back the frame-copy
+// switch, which saves the interrupt frame in the PCB and irets into the
+// next thread's, to compare the two with ctxbench; it is uniprocessor only.
+#ifndef FAST_CONTEXT_SWITCH
+#define FAST_CONTEXT_SWITCH 1
+#endif
+
+// Start the application processors (needs the local APIC timer and the
+// kernel stack swap)
+#define SMP FAST_CONTEXT_SWITCH
+
+// Highest number of CPUs brought online, the rest are left parked
+#ifndef MAX_CPUS
+#define MAX_CPUS 8
+#endif
+
+// Default FPU switching strategy (FPU_LAZY or FPU_EAGER), switchable with the fpu command
+#define FPU_DEFAULT_MODE FPU_EAGER
+
+// Compile in the irqsoff and wakeup latency tracers, off until the tracer command enables them
+#define LATENCY_TRACERS 1
+
+// Binary trace level (TRACE_OFF, TRACE_INFO, TRACE_DEBUG, TRACE_VERBOSE),
+// can be overridden with -DKERNEL_TRACE_LEVEL=...
+#ifndef KERNEL_TRACE_LEVEL
+#define KERNEL_TRACE_LEVEL TRACE_INFO
+#endif
+
 
 // These are defined by the linker script
 extern "C" {
@@ -2,10 +2,11 @@
 #include "io.h"
 #include "terminal.h"
 #include "pic.h"
+#include "softirq.h"
 
-char Keyboard::buffer[KEYBOARD_BUFFER_SIZE];
-int Keyboard::buffer_start = 0;
-int Keyboard::buffer_end = 0;
+WaitQueue Keyboard::readers;
+SpscRing<char, KEYBOARD_BUFFER_SIZE> Keyboard::buffer;
+SpscRing<uint8_t, KEYBOARD_SCANCODE_RING> Keyboard::scancodes;
 
 const char Keyboard::scancode_to_ascii[] = {
     0, 0, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
@@ -16,48 +17,60 @@ const char Keyboard::scancode_to_ascii[] = {
 };
 
 void Keyboard::init() {
+    Softirq::open(SOFTIRQ_KEYBOARD, handle_softirq);
     register_interrupt_handler(INT_KEYBOARD, handle_interrupt);
 }
 
+// Top half: reading the scancode acknowledges the controller
 void Keyboard::handle_interrupt(interrupt_frame* frame) {
     uint8_t scancode = inb(KEYBOARD_DATA_PORT);
-     // Check if it's a key press (ignore key release)
-    if (!(scancode & 0x80)) {
-        if (scancode < sizeof(scancode_to_ascii)) {
-            char ascii = scancode_to_ascii[scancode];
-            if (ascii != 0) {
-                enqueue_char(ascii);
-            }
-        }
-    }
+    scancodes.push(scancode); // If the ring is full, the scancode is discarded
+    Softirq::raise(SOFTIRQ_KEYBOARD);
 }
 
-char Keyboard::get_char() {
-    while (!has_char()) {
-        // Wait for a character
-        asm volatile("nop");
+// Bottom half: translates every scancode since the last run, one wakeup per batch
+void Keyboard::handle_softirq() {
+    uint8_t batch[KEYBOARD_SCANCODE_RING];
+    char keys[KEYBOARD_SCANCODE_RING];
+    uint32_t count = scancodes.pop_batch(batch, KEYBOARD_SCANCODE_RING);
+
+    uint32_t added = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        // Check if it's a key press (ignore key release)
+        uint8_t scancode = batch[i];
+        if (scancode & 0x80 || scancode >= sizeof(scancode_to_ascii)) continue;
+        if (scancode_to_ascii[scancode] != 0) keys[added++] = scancode_to_ascii[scancode];
     }
-    return dequeue_char();
+    if (!added) return;
+
+    // If the buffer is full, the rest is discarded. The lock orders the
+    // push against a reader that found the buffer empty and is going to sleep.
+    uint32_t flags = readers.lock_irqsave();
+    buffer.push_batch(keys, added);
+    readers.unlock_irqrestore(flags);
+    readers.wake_all();
 }
 
-bool Keyboard::has_char() {
-    return buffer_start != buffer_end;
+char Keyboard::get_char() {
+    char c = '\0';
+    read(&c, 1, true);
+    return c;
 }
 
-void Keyboard::enqueue_char(char c) {
-    int next_end = (buffer_end + 1) % KEYBOARD_BUFFER_SIZE;
-    if (next_end != buffer_start) {
-        buffer[buffer_end] = c;
-        buffer_end = next_end;
+uint32_t Keyboard::read(char* out, uint32_t length, bool block, interrupt_frame* frame) {
+    if (length == 0) return 0;
+
+    uint32_t flags = readers.lock_irqsave();
+    while (block && !has_char()) {
+        readers.sleep_locked(flags, frame);
+        flags = readers.lock_irqsave();
     }
-    // If buffer is full, the character is discarded
+
+    uint32_t count = buffer.pop_batch(out, length);
+    readers.unlock_irqrestore(flags);
+    return count;
 }
 
-char Keyboard::dequeue_char() {
-    if (buffer_start != buffer_end) {
-        char c = buffer[buffer_start];
-        buffer_start = (buffer_start + 1) % KEYBOARD_BUFFER_SIZE;
-        return c;
-    }
-    return '\0'; // Return null character if buffer is empty
+bool Keyboard::has_char() {
+    return !buffer.empty();
 }
\ No newline at end of file
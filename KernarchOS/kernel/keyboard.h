@@ -3,26 +3,35 @@
 
 #include "types.h"
 #include "isr.h"
+#include "waitqueue.h"
+#include "ringbuffer.h"
 
 #define KEYBOARD_DATA_PORT 0x60
 #define KEYBOARD_STATUS_PORT 0x64
-#define KEYBOARD_BUFFER_SIZE 256
+#define KEYBOARD_BUFFER_SIZE 256         // Translated keys waiting for a reader, a power of two
+#define KEYBOARD_SCANCODE_RING 64   // Raw scancodes between the IRQ and its softirq, a power of two
 
 class Keyboard {
 public:
     static void init();
     static void handle_interrupt(interrupt_frame* frame);
-    static char get_char();
+    static void handle_softirq();
+    static char get_char(); // Blocks until a key is pressed
     static bool has_char();
+    // Where readers wait, for waiters that are not threads
+    static WaitQueue* input_queue() { return &readers; }
+
+    // Copies up to length buffered keys. With block set it first sleeps
+    // until there is at least one; pass the frame from a syscall handler.
+    static uint32_t read(char* out, uint32_t length, bool block, interrupt_frame* frame = nullptr);
 
 private:
-    static char buffer[KEYBOARD_BUFFER_SIZE];
-    static int buffer_start;
-    static int buffer_end;
     static const char scancode_to_ascii[];
-
-    static void enqueue_char(char c);
-    static char dequeue_char();
+    static WaitQueue readers;   // Readers sleep here until the softirq, and pop under its lock
+    // Filled by the softirq, drained by readers
+    static SpscRing<char, KEYBOARD_BUFFER_SIZE> buffer;
+    // Filled by the IRQ, drained by the softirq on the same CPU
+    static SpscRing<uint8_t, KEYBOARD_SCANCODE_RING> scancodes;
 };
 
 #endif // KEYBOARD_H
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "latency.h"
+#include "percpu.h"
+#include "process.h"
+#include "cpu.h"
+#include "spinlock.h"
+
+volatile bool irqsoff_tracing = false;
+static IrqsoffRecord irqsoff_max;
+static TicketLock irqsoff_lock;   // Taken with interrupts already off
+
+volatile bool WakeupTracer::on = false;
+volatile uint32_t WakeupTracer::histogram[WAKEUP_BUCKETS];
+volatile uint32_t WakeupTracer::samples = 0;
+uint64_t WakeupTracer::worst = 0;
+uint32_t WakeupTracer::worst_pid = 0;
+static TicketLock wakeup_lock;
+
+void irqsoff_begin(uint32_t site) {
+    PerCpu* cpu = this_cpu();
+    cpu->irqsoff_site = site;
+    cpu->irqsoff_start = rdtsc();
+}
+
+void irqsoff_end(uint32_t site) {
+    PerCpu* cpu = this_cpu();
+    uint64_t start = cpu->irqsoff_start;
+    if (!start) return; // Masked before tracing was enabled
+    cpu->irqsoff_start = 0;
+
+    uint64_t cycles = rdtsc() - start;
+    if (cycles <= irqsoff_max.cycles) return; // Unlocked look, rechecked below
+
+    irqsoff_lock.lock();
+    if (cycles > irqsoff_max.cycles) {
+        irqsoff_max.cycles = cycles;
+        irqsoff_max.start_site = cpu->irqsoff_site;
+        irqsoff_max.stop_site = site;
+        irqsoff_max.cpu = cpu->id;
+    }
+    irqsoff_lock.unlock();
+}
+
+void IrqsoffTracer::enable(bool on) {
+    // Sections already open were never stamped, they are skipped
+    for (uint32_t i = 0; i < MAX_CPUS; i++) cpus[i].irqsoff_start = 0;
+    irqsoff_tracing = on;
+}
+
+bool IrqsoffTracer::enabled() {
+    return irqsoff_tracing;
+}
+
+void IrqsoffTracer::reset() {
+    uint32_t flags = irqsoff_lock.lock_irqsave();
+    irqsoff_max = IrqsoffRecord();
+    irqsoff_lock.unlock_irqrestore(flags);
+}
+
+IrqsoffRecord IrqsoffTracer::max() {
+    uint32_t flags = irqsoff_lock.lock_irqsave();
+    IrqsoffRecord record = irqsoff_max;
+    irqsoff_lock.unlock_irqrestore(flags);
+    return record;
+}
+
+void IrqsoffTracer::begin(uint32_t site) {
+    irqsoff_begin(site);
+}
+
+void IrqsoffTracer::end(uint32_t site) {
+    irqsoff_end(site);
+}
+
+void WakeupTracer::enable(bool enable) {
+    on = enable;
+}
+
+void WakeupTracer::reset() {
+    uint32_t flags = wakeup_lock.lock_irqsave();
+    for (uint32_t i = 0; i < WAKEUP_BUCKETS; i++) histogram[i] = 0;
+    samples = 0;
+    worst = 0;
+    worst_pid = 0;
+    wakeup_lock.unlock_irqrestore(flags);
+}
+
+void WakeupTracer::woken(PCB* pcb) {
+    pcb->woken_at = on ? rdtsc() : 0;
+}
+
+void WakeupTracer::running(PCB* pcb, uint64_t now_tsc) {
+    uint64_t woken_at = pcb->woken_at;
+    if (!woken_at) return;
+    pcb->woken_at = 0;
+
+    uint64_t cycles = now_tsc > woken_at ? now_tsc - woken_at : 0;
+    uint32_t clamped = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)cycles;
+    uint32_t index = 31 - __builtin_clz(clamped | 1);
+
+    __atomic_add_fetch(&histogram[index], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&samples, 1, __ATOMIC_RELAXED);
+    if (cycles > worst) {
+        wakeup_lock.lock();
+        if (cycles > worst) {
+            worst = cycles;
+            worst_pid = pcb->pid;
+        }
+        wakeup_lock.unlock();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "types.h"
+
+#define WAKEUP_BUCKETS 32   // log2 of the latency in TSC cycles
+
+struct PCB;
+
+// Longest stretch a CPU ran with interrupts masked. Sections start where
+// IF goes from set to clear (irq_save, interrupt entry, after a softirq
+// pass) and end where it is set again (irq_restore, sti, interrupt exit);
+// the sites are the addresses of those spots, look them up with nm.
+struct IrqsoffRecord {
+    uint64_t cycles;
+    uint32_t start_site;
+    uint32_t stop_site;
+    uint32_t cpu;
+};
+
+class IrqsoffTracer {
+public:
+    static void enable(bool on);
+    static bool enabled();
+    static void reset();
+    static IrqsoffRecord max();
+
+    // From the hooks in cpu.h, isr_handler and Softirq::run
+    static void begin(uint32_t site);
+    static void end(uint32_t site);
+};
+
+// Time from a blocked thread becoming READY to it running
+class WakeupTracer {
+public:
+    static void enable(bool on);
+    static bool enabled() { return on; }
+    static void reset();
+
+    // From sched_wakeup and schedule()
+    static void woken(PCB* pcb);
+    static void running(PCB* pcb, uint64_t now_tsc);
+
+    static uint32_t bucket(uint32_t index) { return histogram[index]; }
+    static uint32_t count() { return samples; }
+    static uint64_t max_cycles() { return worst; }
+    static uint32_t max_pid() { return worst_pid; }
+
+private:
+    static volatile bool on;
+    static volatile uint32_t histogram[WAKEUP_BUCKETS];
+    static volatile uint32_t samples;
+    static uint64_t worst;
+    static uint32_t worst_pid;
+};
+
+#endif // LATENCY_H
@@ -4,6 +4,7 @@
 #include "terminal.h"
 #include "string_utils.h"
 #include "io.h"
+#include "trace.h"
 
 enum LogLevel {
     DEBUG,
@@ -64,6 +65,14 @@ public:
         log(CRITICAL, format, args...);
     }
 
+    // Binary trace into the ring buffer, filtered at compile time
+    template <TraceLevel level>
+    static void trace(TraceEvent event, uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0) {
+        if constexpr (level <= KERNEL_TRACE_LEVEL) {
+            TraceBuffer::record(event, arg0, arg1, arg2);
+        }
+    }
+
     static void serial_log(const char* format, ...) {
         char buffer[512]; // Buffer size for formatted message
         va_list args; // Variable argument list
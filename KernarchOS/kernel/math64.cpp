@@ -56,4 +56,10 @@ uint64_t mod64(uint64_t num, uint64_t den) {
         qbit >>= 1;
     }
     return num; // Remainder
-}
\ No newline at end of file
+}
+
+uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift) {
+    uint64_t low = (uint64_t)(uint32_t)a * mul;
+    uint64_t high = (uint64_t)(uint32_t)(a >> 32) * mul;
+    return (high + (low >> 32)) >> (shift - 32);
+}
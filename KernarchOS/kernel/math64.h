@@ -9,4 +9,7 @@ uint64_t mul64(uint64_t a, uint64_t b);
 uint64_t div64(uint64_t num, uint64_t den);
 uint64_t mod64(uint64_t num, uint64_t den);
 
+// (a * mul) >> shift without a 128-bit intermediate, shift must be 32..63
+uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t shift);
+
 #endif // MATH64_H
\ No newline at end of file
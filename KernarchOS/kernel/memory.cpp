@@ -3,6 +3,7 @@
 #include "interrupts.h"
 #include "cstring.h"
 #include "kernel_config.h"
+#include "spinlock.h"
 
 using namespace std;
 
@@ -22,6 +23,9 @@ struct block_meta {
 
 static block_meta* heap_start_block = nullptr;
 
+// Guards the block list, taken with interrupts off so IRQ paths may allocate
+static McsLock heap_lock;
+
 void init_memory() {
     if (kmalloc_size == 0)
     {
@@ -113,6 +117,7 @@ void* kmalloc(size_t size) {
 
     size = ALIGN_UP(size, sizeof(void*));  // Align to pointer size
     
+    McsGuard guard(heap_lock);
     block_meta* best_fit = nullptr;
     block_meta* current = heap_start_block;
 
@@ -195,6 +200,7 @@ void aligned_kfree(void* ptr) {
 void kfree(void* ptr) {
     if (!ptr) return;
 
+    McsGuard guard(heap_lock);
     block_meta* block = (block_meta*)((char*)ptr - sizeof(block_meta));
     block->free = true;
 
@@ -233,6 +239,7 @@ void* krealloc(void* ptr, size_t new_size) {
 
 void print_heap_info() {
     term_print("Heap info:\n");
+    McsGuard guard(heap_lock);
     block_meta* current = heap_start_block;
     int block_count = 0;
     size_t free_memory = 0;
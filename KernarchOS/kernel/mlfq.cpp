@@ -0,0 +1,43 @@
+#include "mlfq.h"
+#include "process.h"
+#include "timer.h"
+
+uint32_t Mlfq::top_level(PCB* pcb) {
+    uint32_t priority = pcb->priority > PRIORITY_MAX ? PRIORITY_MAX : pcb->priority;
+    return PRIORITY_MAX - priority;
+}
+
+uint32_t Mlfq::slice_ms(PCB* pcb) {
+    return SCHEDULER_SLICE_MS << pcb->mlfq_level;
+}
+
+uint32_t Mlfq::remaining_ms(PCB* pcb) {
+    uint32_t slice = slice_ms(pcb);
+    return pcb->slice_used < slice ? slice - pcb->slice_used : 1;
+}
+
+void Mlfq::reset(PCB* pcb) {
+    pcb->mlfq_level = top_level(pcb);
+    pcb->slice_used = 0;
+}
+
+void Mlfq::charge(PCB* pcb, uint32_t now) {
+    pcb->slice_used += now - pcb->run_start;
+    pcb->run_start = now;
+
+    // Allotment is kept across yields and sleeps, so giving up the CPU
+    // just before the slice ends does not dodge the demotion
+    if (pcb->slice_used >= slice_ms(pcb)) {
+        if (pcb->mlfq_level < MLFQ_LEVELS - 1) pcb->mlfq_level++;
+        pcb->slice_used = 0;
+    }
+}
+
+void Mlfq::wake_boost(PCB* pcb) {
+    if (pcb->policy != SCHED_MLFQ) return;
+
+    if (pcb->mlfq_level > top_level(pcb)) {
+        pcb->mlfq_level--;
+        pcb->slice_used = 0;
+    }
+}
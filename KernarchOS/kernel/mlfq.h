@@ -0,0 +1,42 @@
+#ifndef MLFQ_H
+#define MLFQ_H
+
+#include "types.h"
+
+// Multilevel feedback queue policy. Level 0 is served first; a thread
+// that uses up its level's allotment drops a level, waking from a sleep
+// or I/O wait lifts it one level, and every MLFQ_BOOST_MS all threads go
+// back to the top level their priority allows.
+#define MLFQ_LEVELS 4
+#define MLFQ_BOOST_MS 1000
+
+// PCB priorities, higher runs first. Idle is never queued.
+#define PRIORITY_IDLE        0
+#define PRIORITY_BATCH       1   // Starts two levels down, for background compute
+#define PRIORITY_NORMAL      2
+#define PRIORITY_INTERACTIVE 3   // Starts at level 0, like the terminal
+#define PRIORITY_MAX         PRIORITY_INTERACTIVE
+
+struct PCB;
+
+class Mlfq {
+public:
+    // Highest level the thread's priority allows
+    static uint32_t top_level(PCB* pcb);
+
+    // Allotment at the thread's current level, doubling per level
+    static uint32_t slice_ms(PCB* pcb);
+    // What is left of it, never zero
+    static uint32_t remaining_ms(PCB* pcb);
+
+    // Back to the top level with a fresh allotment
+    static void reset(PCB* pcb);
+
+    // Charges the time run since pcb->run_start, demoting a CPU hog
+    static void charge(PCB* pcb, uint32_t now);
+
+    // Called when a blocked thread becomes runnable again, MLFQ threads only
+    static void wake_boost(PCB* pcb);
+};
+
+#endif // MLFQ_H
@@ -1,15 +1,40 @@
 #include "mutex.h"
-#include "terminal.h"
-#include "interrupts.h"
 
-// Lock the mutex (spinlock until successful)
+bool Mutex::try_lock() {
+    uint32_t expected = 0;
+    return __atomic_compare_exchange_n(&state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
 void Mutex::lock() {
-    while (__atomic_test_and_set(&lockFlag, __ATOMIC_ACQUIRE)) {
-        sys_schedule();
+    if (try_lock()) return;
+
+    // The owner is often running on another CPU and about to release it
+    for (uint32_t i = 0; i < MUTEX_SPIN_COUNT; i++) {
+        asm volatile("pause");
+        if (__atomic_load_n(&state, __ATOMIC_RELAXED) == 0 && try_lock()) return;
+    }
+
+    uint32_t flags = waiters.lock_irqsave();
+    if (__atomic_exchange_n(&state, 2, __ATOMIC_ACQUIRE) == 0) {
+        // Released in the meantime, it is ours
+        if (waiters.empty()) state = 1;
+        waiters.unlock_irqrestore(flags);
+        return;
     }
+
+    // unlock() wakes us with the mutex already ours
+    waiters.sleep_locked(flags);
 }
 
-// Unlock the mutex
 void Mutex::unlock() {
-    __atomic_clear(&lockFlag, __ATOMIC_RELEASE);
+    uint32_t expected = 1;
+    if (__atomic_compare_exchange_n(&state, &expected, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) return;
+
+    uint32_t flags = waiters.lock_irqsave();
+    if (!waiters.wake_thread_locked()) {
+        __atomic_store_n(&state, 0, __ATOMIC_RELEASE);
+    } else if (waiters.empty()) {
+        __atomic_store_n(&state, 1, __ATOMIC_RELEASE); // Handed over, nobody left behind it
+    }
+    waiters.unlock_irqrestore(flags);
 }
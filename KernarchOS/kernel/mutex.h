@@ -2,13 +2,25 @@
 #define MUTEX_H
 
 #include "types.h"
+#include "waitqueue.h"
 
+// Spins this many times before a contended lock() goes to sleep
+#define MUTEX_SPIN_COUNT 100
+
+// Sleeping mutex, futex style: uncontended lock and unlock are a single
+// atomic each. A contended lock() spins briefly, then blocks on the wait
+// queue, and unlock() hands ownership straight to the first waiter, so
+// waiters cost no CPU and cannot be overtaken by a newcomer.
 class Mutex {
 public:
     void lock();
+    bool try_lock();
     void unlock();
 
-    volatile uint32_t lockFlag; // 0 means unlocked, 1 means locked
+    volatile uint32_t state; // 0 unlocked, 1 locked, 2 locked with waiters
+
+private:
+    WaitQueue waiters;
 };
 
 #endif // MUTEX_H
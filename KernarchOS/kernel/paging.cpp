@@ -146,4 +146,14 @@ bool map_user_page(uint32_t virtual_address, uint32_t physical_address, bool is_
 
 void flush_tlb() {
     asm volatile("mov %%cr3, %%eax; mov %%eax, %%cr3" : : : "eax");
-}
\ No newline at end of file
+}
+
+// Identity maps a device register page as uncached
+void map_mmio_page(uint32_t physical_address) {
+    uint32_t pd_index = physical_address >> 22;
+    uint32_t pt_index = (physical_address >> 12) & 0x3FF;
+
+    // Present, writable, write-through, cache disabled
+    kernel_page_tables[pd_index].pages[pt_index] = (physical_address & 0xFFFFF000) | 0x1B;
+    asm volatile("invlpg (%0)" ::"r" (physical_address) : "memory");
+}
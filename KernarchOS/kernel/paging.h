@@ -29,5 +29,6 @@ uint32_t get_physical_address(uint32_t virtual_address);
 bool is_page_present(uint32_t virtual_address);
 bool map_user_page(uint32_t virtual_address, uint32_t physical_address, bool is_writable);
 void flush_tlb();
+void map_mmio_page(uint32_t physical_address);
 
 #endif // PAGING_H
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "percpu.h"
+#include "gdt.h"
+
+PerCpu cpus[MAX_CPUS];
+volatile uint32_t cpu_count = 0;
+
+static_assert(__builtin_offsetof(PerCpu, self) == 0, "this_cpu reads %gs:0");
+static_assert(__builtin_offsetof(PerCpu, current) == 4, "this_cpu_current reads %gs:4");
+
+void percpu_init(uint32_t id) {
+    PerCpu* cpu = &cpus[id];
+    cpu->self = cpu;
+    cpu->id = id;
+
+    // Interrupt entry finds this descriptor right after the CPU's TSS (see interrupt.asm)
+    gdt_set_gate(GDT_PERCPU_ENTRY(id), (uint32_t)cpu, sizeof(PerCpu) - 1, 0xF2, 0x40);
+    asm volatile("mov %0, %%gs" : : "r"((uint16_t)PERCPU_SEG(id)));
+
+    Tls::init_cpu(id, &cpu->boot_tls);
+}
@@ -0,0 +1,70 @@
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include "types.h"
+#include "kernel_config.h"
+#include "runqueue.h"
+#include "softirq.h"
+#include "tls.h"
+
+#define CPU_ANY 0xFFFFFFFF  // No CPU affinity
+
+struct PCB;
+
+// Data owned by one CPU. Each CPU's GS descriptor has its base at its own
+// block, so %gs:0 always yields the PerCpu of the CPU executing it.
+struct PerCpu {
+    PerCpu* self;            // %gs:0
+    PCB* current;            // %gs:4, the running process
+    uint32_t id;             // Logical index, 0 is the boot processor
+    uint32_t apic_id;
+    volatile bool online;    // Set once the idle thread exists and it can take work
+
+    PCB* idle;               // Runs when nothing is queued or can be stolen
+    PCB* prev;               // Process being switched away from
+    RunQueue runqueue;
+
+    uint32_t slice_end;      // End of the running thread's time slice
+    uint32_t last_boost;     // Last MLFQ anti-starvation boost
+    uint32_t dl_bandwidth;   // Per mille reserved by admitted deadline threads
+    volatile bool need_resched; // Woke something that should preempt, schedule on interrupt exit
+    volatile uint32_t softirq_pending; // Bit per SoftirqType
+    bool in_softirq;         // Running bottom halves, schedule() is deferred
+    PCB* fpu_owner;          // Process whose state is in this CPU's FPU registers
+
+    uint32_t switches;
+    uint32_t steals;
+    uint32_t ipis;           // Reschedule IPIs received
+    uint32_t softirq_raised[SOFTIRQ_COUNT];
+    uint32_t softirq_runs[SOFTIRQ_COUNT]; // Handler passes, each may cover many raises
+
+    uint64_t irqsoff_start;  // IrqsoffTracer: TSC when interrupts were masked, 0 if untraced
+    uint32_t irqsoff_site;
+
+    TlsBlock boot_tls;       // FS block until the first switch, and for TLS-less processes
+};
+
+extern PerCpu cpus[MAX_CPUS];
+extern volatile uint32_t cpu_count;
+
+// Fills in cpus[id] and points this CPU's GS at it
+void percpu_init(uint32_t id);
+
+static inline PerCpu* this_cpu() {
+    PerCpu* cpu;
+    asm volatile("mov %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+// A single instruction, so it stays right even if the caller migrates
+static inline PCB* this_cpu_current() {
+    PCB* pcb;
+    asm volatile("mov %%gs:4, %0" : "=r"(pcb));
+    return pcb;
+}
+
+static inline bool cpu_is_idle(PerCpu* cpu) {
+    return cpu->current == cpu->idle && cpu->runqueue.size() == 0;
+}
+
+#endif // PERCPU_H
@@ -31,6 +31,16 @@ void pic_sendEOI(uint8_t irq) {
     outb(PIC1_COMMAND, PIC_EOI);
 }
 
+void pic_mask_irq(uint8_t irq) {
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) | (1 << (irq & 7)));
+}
+
+void pic_unmask_irq(uint8_t irq) {
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) & ~(1 << (irq & 7)));
+}
+
 void pic_init() {
     term_print("Initializing PIC...\n");
     pic_remap(0x20, 0x28);
@@ -14,6 +14,8 @@
 
 void pic_remap(int offset1, int offset2);
 void pic_sendEOI(uint8_t irq);
+void pic_mask_irq(uint8_t irq);
+void pic_unmask_irq(uint8_t irq);
 void pic_init();
 
 #endif // PIC_H
\ No newline at end of file
@@ -4,41 +4,138 @@
 #include "logger.h"
 #include "isr.h"
 #include "process.h"
+#include "sleep_queue.h"
+#include "timer.h"
+#include "pic.h"
 
 //Warning: pit will overflow after about 49.7 days at 1000 Hz
 volatile uint32_t pit_ticks = 0;
 uint32_t pit_frequency = 0;
-void (*scheduler_callback)(interrupt_frame* interrupt_frame) = nullptr;
+
+static uint16_t pit_divisor = 0;
+
+// One-shot state used while the CPU idles with the periodic tick stopped
+static bool oneshot_armed = false;
+static uint16_t oneshot_count = 0;   // PIT counts programmed for the shot
+static uint32_t oneshot_ticks = 0;   // Ticks the shot stands for
+static uint32_t partial_counts = 0;  // Counts short of a whole tick, left by early restarts
+
+static void pit_program_periodic() {
+    outb(PIT_COMMAND, 0x36);  // Command byte: Channel 0, lobyte/hibyte, square wave
+    outb(PIT_CHANNEL0, pit_divisor & 0xFF);         // Low byte
+    outb(PIT_CHANNEL0, (pit_divisor >> 8) & 0xFF);  // High byte
+}
+
+static void pit_program_oneshot(uint16_t count) {
+    outb(PIT_COMMAND, 0x30);  // Channel 0, lobyte/hibyte, interrupt on terminal count
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, (count >> 8) & 0xFF);  // Counting starts after the high byte
+}
+
+static uint16_t pit_read_count() {
+    outb(PIT_COMMAND, 0x00);  // Latch channel 0
+    uint8_t low = inb(PIT_CHANNEL0);
+    uint8_t high = inb(PIT_CHANNEL0);
+    return ((uint16_t)high << 8) | low;
+}
+
+// PIT counts elapsed since the armed one-shot was programmed, plus the
+// partial tick carried over from earlier restarts
+static uint32_t oneshot_elapsed_counts() {
+    uint16_t remaining = pit_read_count();
+    if (remaining > oneshot_count) remaining = 0; // Already fired and wrapped
+    return (uint32_t)(oneshot_count - remaining) + partial_counts;
+}
 
 void pit_init(uint32_t frequency) {
     pit_frequency = frequency;
-    uint32_t divisor = PIT_BASE_FREQUENCY / frequency;
-    
-    outb(0x43, 0x36);  // Command byte: Channel 0, lobyte/hibyte, square wave
-    outb(0x40, divisor & 0xFF);         // Low byte
-    outb(0x40, (divisor >> 8) & 0xFF);  // High byte
+    pit_divisor = PIT_BASE_FREQUENCY / frequency;
+
+    pit_program_periodic();
 
     register_interrupt_handler(INT_TIMER, pit_handler);
 }
 
 void pit_handler(interrupt_frame* interrupt_frame) {
-    pit_ticks++;
+    bool was_oneshot = oneshot_armed;
 
-    if (pit_ticks % 10 == 0 && scheduler_callback) {
-        outb(0x20, 0x20); // Send EOI to the master PIC
-        scheduler_callback(interrupt_frame);
+    if (was_oneshot) {
+        // The shot has expired, account the whole idle period at once
+        pit_ticks = pit_ticks + oneshot_ticks;
+        oneshot_armed = false;
+    } else {
+        pit_ticks = pit_ticks + 1;
     }
+
+    timer_event(interrupt_frame, was_oneshot);
 }
 
-uint32_t pit_get_ticks() {
-    return pit_ticks;
+// Stops IRQ0 once another device has taken over as the scheduler clock
+void pit_disable() {
+    pit_restart_tick();
+    pic_mask_irq(INT_TIMER - HARDWARE_INT_BASE);
+    unregister_interrupt_handler(INT_TIMER, pit_handler);
 }
 
-uint32_t get_current_time_ms() {
-    return (pit_ticks * 1000) / pit_frequency;
+// Channel 2 runs a single countdown with its gate driven through port 0x61,
+// so other clocks can be calibrated without interrupts
+void pit_calibration_start(uint32_t ms) {
+    uint32_t count = (PIT_BASE_FREQUENCY / 1000) * ms;
+    if (count > 0xFFFF) count = 0xFFFF;
+
+    uint8_t gate = inb(PIT_GATE_PORT) & ~0x02;  // Speaker off
+    outb(PIT_GATE_PORT, gate & ~0x01);           // Gate low while programming
+    outb(PIT_COMMAND, 0xB0);                     // Channel 2, lobyte/hibyte, mode 0
+    outb(PIT_CHANNEL2, count & 0xFF);
+    outb(PIT_CHANNEL2, (count >> 8) & 0xFF);
+    outb(PIT_GATE_PORT, gate | 0x01);            // Rising gate edge starts counting
 }
 
+bool pit_calibration_done() {
+    return (inb(PIT_GATE_PORT) & 0x20) != 0;     // OUT2 goes high at terminal count
+}
 
-void pit_register_scheduler(void (*scheduler_func)(interrupt_frame* interrupt_frame)) {
-    scheduler_callback = scheduler_func;
-}
\ No newline at end of file
+void pit_stop_tick(uint32_t wake_time_ms) {
+    if (oneshot_armed) pit_restart_tick();
+
+    // Without sleepers, sleep as long as the 16-bit counter allows
+    uint32_t max_ticks = (0xFFFF / pit_divisor);
+    uint32_t ticks = max_ticks;
+    if (wake_time_ms != SLEEP_QUEUE_EMPTY) {
+        int32_t delta_ms = (int32_t)(wake_time_ms - pit_get_time_ms());
+        if (delta_ms <= 0) return; // Already due, keep ticking
+        ticks = ((uint32_t)delta_ms * pit_frequency) / 1000;
+        if (ticks == 0) ticks = 1;
+        if (ticks > max_ticks) ticks = max_ticks;
+    }
+
+    oneshot_ticks = ticks;
+    oneshot_count = ticks * pit_divisor;
+    oneshot_armed = true;
+    pit_program_oneshot(oneshot_count);
+}
+
+void pit_restart_tick() {
+    if (!oneshot_armed) return;
+
+    // Woken before the shot expired, account only the time actually spent
+    // and keep the partial tick for the next restart
+    uint32_t counts = oneshot_elapsed_counts();
+    pit_ticks = pit_ticks + counts / pit_divisor;
+    partial_counts = counts % pit_divisor;
+    oneshot_armed = false;
+    pit_program_periodic();
+}
+
+bool pit_tick_stopped() {
+    return oneshot_armed;
+}
+
+uint32_t pit_get_ticks() {
+    if (oneshot_armed) return pit_ticks + oneshot_elapsed_counts() / pit_divisor;
+    return pit_ticks;
+}
+
+uint32_t pit_get_time_ms() {
+    return (pit_get_ticks() * 1000) / pit_frequency;
+}
@@ -5,12 +5,25 @@
 #include "isr.h"
 
 #define PIT_BASE_FREQUENCY 1193182
+#define PIT_CHANNEL0 0x40
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND 0x43
+#define PIT_GATE_PORT 0x61
 
 void pit_init(uint32_t frequency);
 void pit_handler(interrupt_frame* interrupt_frame);
 uint32_t pit_get_ticks();
-uint32_t get_current_time_ms();
+uint32_t pit_get_time_ms();
+void pit_disable();
 
-void pit_register_scheduler(void (*scheduler_func)(interrupt_frame* interrupt_frame));
+// Dynamic tick: stop the periodic tick until the given deadline (or
+// SLEEP_QUEUE_EMPTY), and restart it once there is work to do again
+void pit_stop_tick(uint32_t wake_time_ms);
+void pit_restart_tick();
+bool pit_tick_stopped();
 
-#endif // PIT_H
\ No newline at end of file
+// Busy-wait calibration window on channel 2
+void pit_calibration_start(uint32_t ms);
+bool pit_calibration_done();
+
+#endif // PIT_H
@@ -6,45 +6,274 @@
 #include "logger.h"
 #include "tss.h"
 #include "io.h"
-#include "pit.h"
+#include "timer.h"
 #include "thread.h"
 #include "interrupts.h"
+#include "sleep_queue.h"
+#include "fpu.h"
+#include "cpu.h"
+#include "smp.h"
+#include "reaper.h"
+#include "workqueue.h"
+#include "latency.h"
+#include "tasktable.h"
+
+// Everything a pick, wakeup or tick reads shares the task's first cache line
+static_assert(__builtin_offsetof(PCB, run_start) + sizeof(uint32_t) <= TASK_CACHE_LINE, "hot task fields spill out of line 0");
+static_assert(__builtin_offsetof(PCB, tls) + sizeof(TlsBlock*) <= 2 * TASK_CACHE_LINE, "class fields spill out of line 1");
+
+// Only what has to happen before the switch away, the reaper frees the
+// stacks and the slot once the zombie is off its CPU
+static void exit_process(PCB* pcb) {
+    pcb->state = ZOMBIE;
+    SleepQueue::remove(pcb);
+    if (pcb->policy == SCHED_DEADLINE) Edf::leave(pcb);
+}
+
+// Lays out a new thread's kernel stack as if it had been switched out
+// inside an interrupt: switch_stacks pops the callee-saved registers and
+// returns into thread_first_run, which finishes the switch and irets
+// through interrupt_return with the initial frame
+static void prepare_kernel_stack(PCB* pcb) {
+    interrupt_frame* frame = (interrupt_frame*)(pcb->kernel_stack->top - sizeof(interrupt_frame));
+    *frame = pcb->context;
+    frame->isr_esp = (uint32_t)&frame->gs;
+
+    uint32_t* sp = (uint32_t*)frame;
+    *--sp = 0;                          // Vector
+    *--sp = (uint32_t)thread_first_run;
+    *--sp = 0;                          // EBP
+    *--sp = 0;                          // EBX
+    *--sp = 0;                          // ESI
+    *--sp = 0;                          // EDI
+    pcb->kernel_esp = (uint32_t)sp;
+}
 
-#define STACK_SIZE 8192 // 8KB stack size
+#if !FAST_CONTEXT_SWITCH
+// Frame-copy switch, uniprocessor only. A thread preempted or yielding
+// from ring 3 with nothing but the interrupt frame on its kernel stack is
+// saved by copying that frame into its PCB, and resumed by iretd from
+// there. Any other switch, such as a block inside a system call, still
+// saves the kernel stack.
+static bool frame_copyable(PCB* pcb, interrupt_frame* frame) {
+    return frame && (frame->cs & 3) == 3 && pcb->state == READY &&
+           (uint32_t)(frame + 1) == pcb->kernel_stack->top;
+}
 
-PCB process_table[MAX_PROCESSES];
-PCB* current_process = nullptr;
-uint32_t next_pid = 0;
+// On the way into a copied frame, for what schedule() would do after the switch
+extern "C" void frame_switch_tail(interrupt_frame* next) {
+    schedule_tail();
+    if (next->eflags & EFLAGS_IF) trace_irqs_on();
+}
+#endif
 
+static void switch_to(PCB* prev, PCB* next, interrupt_frame* frame) {
+    static uint32_t discarded_esp; // Boot stacks never resume
+    uint32_t* prev_esp = prev ? &prev->kernel_esp : &discarded_esp;
 
-void init_processes() {
-    memset(process_table, 0, sizeof(process_table));
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        process_table[i].pid = 0;
-        process_table[i].state = TERMINATED;
+#if !FAST_CONTEXT_SWITCH
+    if (prev && frame_copyable(prev, frame)) {
+        prev->context = *frame;
+        prev->context_saved = true;
+        prev_esp = &discarded_esp; // Its kernel stack is never resumed
+    }
+    if (next->context_saved) {
+        next->context_saved = false;
+        save_and_load_context(prev_esp, &next->context); // Returns only through switch_stacks
+        return;
+    }
+#endif
+    switch_stacks(prev_esp, next->kernel_esp);
+}
+
+// Earliest sleeper or delayed work the stopped tick has to wake up for
+static uint32_t next_timer_event() {
+    uint32_t wake = SleepQueue::next_wake_time();
+    uint32_t due = WorkQueue::next_due();
+    if (wake == SLEEP_QUEUE_EMPTY) return due;
+    if (due == SLEEP_QUEUE_EMPTY) return wake;
+    return (int32_t)(due - wake) < 0 ? due : wake;
+}
+
+// Prefers the CPU the process last ran on, unless another one sits idle
+static PerCpu* select_cpu(PCB* pcb) {
+    if (pcb->affinity != CPU_ANY) return &cpus[pcb->affinity];
+
+    PerCpu* best = &cpus[pcb->cpu];
+    if (cpu_is_idle(best)) return best;
+
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        PerCpu* cpu = &cpus[i];
+        if (!cpu->online) continue;
+        if (cpu_is_idle(cpu)) return cpu;
+        if (cpu->runqueue.size() < best->runqueue.size()) best = cpu;
+    }
+    return best;
+}
+
+// Class hooks for a blocked process that becomes READY
+static void sched_wakeup(PCB* pcb) {
+    uint64_t now_tsc = rdtsc();
+    if (pcb->stats.blocked_since && now_tsc > pcb->stats.blocked_since) {
+        pcb->stats.sleep += now_tsc - pcb->stats.blocked_since;
+    }
+    pcb->stats.blocked_since = 0;
+
+    Mlfq::wake_boost(pcb);
+    Edf::wake(pcb, get_current_time_ms());
+    WakeupTracer::woken(pcb);
+}
+
+// Whether pcb should take the CPU from running
+static bool sched_preempts(PCB* pcb, PCB* running) {
+    if (sched_rank(pcb) != sched_rank(running)) return sched_rank(pcb) < sched_rank(running);
+    return pcb->policy == SCHED_DEADLINE && Edf::earlier(pcb, running);
+}
+
+static void enqueue_process(PCB* pcb) {
+    PerCpu* target = select_cpu(pcb);
+    pcb->stats.ready_since = rdtsc();
+    target->runqueue.push(pcb);
+
+    // Kick an idle CPU, or one running something that ranks lower
+    PCB* running = target->current;
+    if (running == target->idle || (running && sched_preempts(pcb, running))) {
+        if (target != this_cpu()) smp_send_reschedule(target);
+        else target->need_resched = true;
+    }
+}
+
+// Runs on the new thread's stack right after every switch
+extern "C" void schedule_tail() {
+    PerCpu* cpu = this_cpu();
+    PCB* prev = cpu->prev;
+    cpu->prev = nullptr;
+
+    if (prev) {
+        // Its kernel stack is free now, other CPUs may pick it up
+        prev->lock.lock();
+        bool wake = prev->wake_pending && prev->state == BLOCKED;
+        if (wake) {
+            prev->state = READY;
+            sched_wakeup(prev);
+        }
+        prev->wake_pending = false;
+        __atomic_store_n(&prev->on_cpu, false, __ATOMIC_RELEASE);
+        prev->lock.unlock();
+
+        if (wake) enqueue_process(prev);
+        if (prev->state == ZOMBIE) Reaper::add(prev);
+    }
+}
+
+void wake_process(PCB* pcb) {
+    uint32_t flags = irq_save();
+    PerCpu* cpu = this_cpu();
+    bool enqueue = false;
+
+    pcb->lock.lock();
+    if (pcb == cpu->current) {
+        // Woken before it switched out, schedule() keeps it runnable
+        if (pcb->state == BLOCKED) {
+            pcb->state = READY;
+            sched_wakeup(pcb);
+        }
+    } else if (pcb->on_cpu) {
+        // Still on another CPU; queueing it now would let two CPUs run
+        // on its kernel stack, so that CPU queues it after the switch
+        pcb->wake_pending = true;
+    } else if (pcb->state == BLOCKED) {
+        pcb->state = READY;
+        sched_wakeup(pcb);
+        enqueue = true;
     }
+    pcb->lock.unlock();
+
+    if (enqueue) enqueue_process(pcb);
+    irq_restore(flags);
+}
+
+void set_process_priority(PCB* pcb, uint32_t priority) {
+    pcb->priority = priority > PRIORITY_MAX ? PRIORITY_MAX : priority;
+    Mlfq::reset(pcb);
+}
+
+void set_process_policy(PCB* pcb, SchedPolicy policy, int32_t nice) {
+    if (pcb->policy == SCHED_DEADLINE) Edf::leave(pcb);
+    pcb->policy = policy == SCHED_DEADLINE ? SCHED_MLFQ : policy;
+    pcb->nice = nice < NICE_MIN ? NICE_MIN : (nice > NICE_MAX ? NICE_MAX : nice);
+    pcb->weight = Fair::weight(pcb->nice);
+    Mlfq::reset(pcb);
+}
+
+bool set_process_deadline(PCB* pcb, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms) {
+    if (pcb->policy == SCHED_DEADLINE) set_process_policy(pcb, SCHED_MLFQ);
+    if (!Edf::admit(pcb, runtime_ms, deadline_ms, period_ms)) return false;
+
+    pcb->policy = SCHED_DEADLINE;
+    return true;
+}
+
+void wait_next_period(interrupt_frame* frame) {
+    PCB* pcb = current_process;
+    if (!pcb || pcb->policy != SCHED_DEADLINE) return;
+
+    uint32_t now = get_current_time_ms();
+    uint32_t release = Edf::finish_job(pcb, now);
+    if (release != now) ThreadManager::sleep_current(release - now);
+    schedule(frame);
+}
+
+void set_process_affinity(PCB* pcb, uint32_t cpu) {
+    if (pcb->policy == SCHED_DEADLINE) return; // Stays on the CPU that admitted it
+    pcb->affinity = cpu < MAX_CPUS && cpus[cpu].online ? cpu : CPU_ANY;
+}
+
+// Takes a process from the CPU with the longest run queue
+static PCB* steal_process(PerCpu* cpu) {
+    PerCpu* busiest = nullptr;
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        PerCpu* other = &cpus[i];
+        if (other == cpu || !other->online || other->runqueue.size() == 0) continue;
+        if (!busiest || other->runqueue.size() > busiest->runqueue.size()) busiest = other;
+    }
+    if (!busiest) return nullptr;
+
+    PCB* pcb = busiest->runqueue.steal();
+    if (pcb) cpu->steals++;
+    return pcb;
+}
+
+void init_processes() {
+    TaskTable::prefill(TASK_POOL_PREFILL);
+    init_idle_process();
+
+    //Register the scheduler
+    timer_register_scheduler(schedule);
+}
 
-    Thread* idleThread = ThreadManager::create_thread(idle_task);
+// Every CPU has its own idle thread, it is never queued or stolen
+void init_idle_process() {
+    PerCpu* cpu = this_cpu();
+    Thread* idleThread = ThreadManager::create_thread(idle_task, nullptr, false);
 
     if (idleThread)
     {
-        idleThread->pcb->priority = 0;
-        idleThread->pcb->state = READY;
+        set_process_priority(idleThread, PRIORITY_IDLE);
+        idleThread->state = READY;
+        idleThread->cpu = cpu->id;
+        cpu->idle = idleThread;
 
-        idleThread->pcb->context.eflags |= 0x200;
+        // The CPU can take work from now on
+        cpu->online = true;
+        __atomic_add_fetch(&cpu_count, 1, __ATOMIC_RELEASE);
 
-        Logger::log(LogLevel::INFO, "Idle process created with PID %d", idleThread->pcb->pid);
+        Logger::log(LogLevel::INFO, "Idle process for CPU %d created with PID %d", cpu->id, idleThread->pid);
     }
     else
     {
-        Logger::log(LogLevel::ERROR, "Failed to create idle process");
+        Logger::log(LogLevel::ERROR, "Failed to create idle process for CPU %d", cpu->id);
     }
-    //Set up TSS stack
-    uint32_t tss_stack = StackManager::allocate_stack(8192)->top;
-    tss_set_stack(tss_stack);
-    Logger::debug("TSS stack set to 0x%x", tss_stack);
-    //Register the scheduler
-    pit_register_scheduler(schedule);
 }
 
 #define SYSCALL_YIELD 0x80
@@ -55,56 +284,101 @@ void idle_task() {
     }
 }
 
-PCB* create_process(void (*entry_point)()) {
-    // Find free PCB
-    PCB* pcb = nullptr;
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (process_table[i].state == TERMINATED) {
-            pcb = &process_table[i];
-            break;
-        }
+// A shell from the task pool still has its stacks, FPU state and TLS
+// block, they are only reset; anything missing is allocated
+bool alloc_task_resources(PCB* pcb) {
+    // Every thread enters the kernel on its own stack, the TSS points at it while it runs
+    if (!pcb->kernel_stack) pcb->kernel_stack = StackManager::allocate_stack(THREAD_KERNEL_STACK_SIZE);
+    // Always allocate user/task stack for both Ring 0 and Ring 3
+    if (!pcb->user_stack) pcb->user_stack = StackManager::allocate_stack(THREAD_STACK_SIZE);
+
+    if (pcb->fpu_state) fpu_init_state(pcb->fpu_state);
+    else pcb->fpu_state = fpu_alloc_state();
+    if (pcb->tls) Tls::reset(pcb->tls);
+    else pcb->tls = Tls::create();
+
+    return pcb->kernel_stack && pcb->user_stack && pcb->fpu_state && pcb->tls;
+}
+
+void free_task_resources(PCB* pcb) {
+    if (pcb->user_stack) {
+        StackManager::destroy_stack(pcb->user_stack);
+        pcb->user_stack = nullptr;
     }
-    
+    if (pcb->kernel_stack) {
+        StackManager::destroy_stack(pcb->kernel_stack);
+        pcb->kernel_stack = nullptr;
+    }
+    fpu_release(pcb);
+    Tls::destroy(pcb->tls);
+    pcb->tls = nullptr;
+}
+
+PCB* create_process(void (*entry_point)(), void* arg) {
+    // Claimed and BLOCKED, not runnable until wake_process
+    PCB* pcb = TaskTable::allocate();
     if (!pcb) {
         Logger::log(LogLevel::ERROR, "Failed to create process: No free PCB");
         return nullptr;
     }
 
+    bool pooled = pcb->kernel_stack != nullptr;
+    if (!alloc_task_resources(pcb)) {
+        Logger::log(LogLevel::ERROR, "Failed to create process: Out of memory");
+        TaskTable::release(pcb);
+        return nullptr;
+    }
+
     // Initialize PCB
-    pcb->pid = next_pid++;
-    pcb->state = READY;
-    pcb->priority = 1;
-    pcb->fpu_state = nullptr;
+    set_process_priority(pcb, PRIORITY_NORMAL);
+    set_process_policy(pcb, SCHED_MLFQ);
+    pcb->vruntime = 0;
+    pcb->fpu_cpu = FPU_NO_CPU;
+    pcb->tls->thread = pcb;
+    pcb->cpu = this_cpu()->id;
+    pcb->affinity = CPU_ANY;
+    pcb->on_cpu = false;
+    pcb->rq_next = pcb->rq_prev = nullptr;
+    pcb->wq_next = nullptr;
+    pcb->wq_queued = false;
+    pcb->exiting = false;
+    pcb->wake_time = 0;
+    pcb->sleep_index = -1;
+    pcb->zombie_next = nullptr;
+    memset(&pcb->stats, 0, sizeof(pcb->stats));
+    pcb->woken_at = 0;
 
         // Initialize context
     memset(&pcb->context, 0, sizeof(interrupt_frame));
+    pcb->context_saved = false;
 
-    // Always allocate kernel stack for both Ring 0 and Ring 3
-    //pcb->kernel_stack = StackManager::allocate_stack(STACK_SIZE); // Not used for now
+    // The entry point gets arg as its only parameter
+    uint32_t* user_sp = (uint32_t*)pcb->user_stack->top;
+    *--user_sp = (uint32_t)arg;
+    *--user_sp = 0;                     // Return address, entry points never return
 
-    // Always allocate user/task stack for both Ring 0 and Ring 3
-    pcb->user_stack  = StackManager::allocate_stack(STACK_SIZE);
-
-    pcb->context.esp = pcb->user_stack->top;
+    pcb->context.esp = (uint32_t)user_sp;
     pcb->context.ebp = pcb->user_stack->top;  // Initial stack frame
     
     // Set up registers - always use task stack as main stack
     pcb->context.eip = (uint32_t)entry_point;
 
     
-    // Set up segments
+    // Set up segments (GS and FS are replaced by the per-CPU selectors on return)
     pcb->context.cs = 0x1B;  // CS: Kernel or User code segment
     pcb->context.ds = pcb->context.es = pcb->context.fs = pcb->context.gs = 0x23;  // DS, ES, FS, GS
     pcb->context.ss = 0x23;  // SS: Stack segment for Ring 0 or Ring 3
     
-    // Enable interrupts
-    pcb->context.eflags = 0x202;  // IF + bit 1 (reserved)
+    // Enable interrupts, IOPL 3 lets threads mask them around spinlocks
+    pcb->context.eflags = 0x3202;  // IF + IOPL 3 + bit 1 (reserved)
 
     // Set page directory
     //pcb->context.cr3 = kernel_page_directory.physicalAddr;
 
-    Logger::log(LogLevel::INFO, "Created process PID %d, EIP: 0x%x, ESP: 0x%x",
-                pcb->pid, pcb->context.eip, pcb->context.esp);
+    prepare_kernel_stack(pcb);
+    TaskTable::publish(pcb); // Only now can top and find see it
+
+    Logger::trace<TRACE_INFO>(TRACE_TASK_CREATE, pcb->pid, pcb->context.eip, pooled);
 
     //serial_log("Created process PID %d \n", pcb->pid);
     //print_context(&pcb->context);
@@ -113,148 +387,162 @@ PCB* create_process(void (*entry_point)()) {
 }
 
 
+static uint32_t sched_slice_ms(PerCpu* cpu, PCB* pcb) {
+    if (pcb->policy == SCHED_DEADLINE) return Edf::slice_ms(pcb);
+    if (pcb->policy == SCHED_FAIR) return cpu->runqueue.fair_slice_ms(pcb);
+    return Mlfq::remaining_ms(pcb);
+}
+
 void schedule(interrupt_frame* interrupt_frame) {
-    uint32_t eflags;
-    asm volatile("pushf; pop %0" : "=r"(eflags));
-    asm volatile("cli");
+    uint32_t flags = irq_save();
+    PerCpu* cpu = this_cpu();
 
-    if (current_process && current_process->user_data->state == THREAD_TERMINATED)
-    {
-        ThreadManager::exit_thread();
+    // Interrupted bottom halves finish first, isr_handler schedules after them
+    if (cpu->in_softirq) {
+        cpu->need_resched = true;
+        irq_restore(flags);
+        return;
+    }
+
+    PCB* exiting = cpu->current;
+    if (exiting && exiting->state != ZOMBIE && exiting->exiting) {
+        exit_process(exiting);
     }
 
     // Update sleeping threads
     ThreadManager::update_sleeping_threads();
+    cpu->need_resched = false; // This pick covers everything woken so far
 
-    PCB* old_process = current_process;
+    PCB* old_process = cpu->current;
     PCB* next_process = nullptr;
 
-    if(old_process && !StackManager::is_stack_safe(old_process->user_stack, interrupt_frame->esp)){
+    uint32_t now = get_current_time_ms();
+    uint64_t now_tsc = rdtsc();
+    if (old_process) old_process->stats.runtime += now_tsc - old_process->exec_start;
+
+    if (old_process && old_process != cpu->idle && old_process->state != ZOMBIE) {
+        if (old_process->policy == SCHED_DEADLINE) {
+            // Out of budget: throttled until its deadline, then replenished
+            bool runnable = old_process->state == RUNNING || old_process->state == READY;
+            if (Edf::charge(old_process, now_tsc, now) && runnable) {
+                int32_t wait = (int32_t)(old_process->dl_abs_deadline - now);
+                if (wait > 0) ThreadManager::sleep_current(wait);
+                else Edf::wake(old_process, now);
+            }
+        } else if (old_process->policy == SCHED_FAIR) {
+            Fair::charge(old_process, now_tsc);
+            cpu->runqueue.update_min_vruntime(old_process);
+        } else {
+            Mlfq::charge(old_process, now);
+        }
+    }
+    if (old_process) old_process->exec_start = now_tsc;
+
+    // Anti-starvation: demoted threads here get their top level back
+    if ((int32_t)(now - cpu->last_boost) >= MLFQ_BOOST_MS) {
+        cpu->last_boost = now;
+        cpu->runqueue.boost();
+        if (old_process && old_process != cpu->idle && old_process->policy == SCHED_MLFQ) Mlfq::reset(old_process);
+    }
+
+    if(old_process && interrupt_frame && (interrupt_frame->cs & 3) == 3 && !old_process->fiber_carrier &&
+       !StackManager::is_stack_safe(old_process->user_stack, interrupt_frame->esp)){
         Logger::log(LogLevel::ERROR, "Stack overflow detected for process PID %d", old_process->pid);
         Logger::log(LogLevel::ERROR, "Stack top: 0x%x, ESP: 0x%x", old_process->user_stack->top, interrupt_frame->esp);
         //ThreadManager::exit_thread();
     }
-    
-    // Try to find the next READY process
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        int idx = (i + (old_process ? (old_process->pid % MAX_PROCESSES) : 0)) % MAX_PROCESSES;
-        if (process_table[idx].state == READY) {
-            Thread* thread = (Thread*)process_table[idx].user_data;
-            if (thread && ThreadManager::is_thread_ready(thread)) {
-                next_process = &process_table[idx];
-                break;
-            }
-        }
+
+    // A preempted thread goes back to this CPU's queue
+    bool requeue_old = old_process && old_process != cpu->idle &&
+                       (old_process->state == RUNNING || old_process->state == READY);
+
+    // Local queue first (only what should preempt a still runnable
+    // thread), then keep running, then steal from a busy CPU
+    next_process = cpu->runqueue.pop(requeue_old ? old_process : nullptr);
+    if (!next_process && requeue_old) {
+        next_process = old_process;
+        requeue_old = false;
     }
+    if (!next_process) next_process = steal_process(cpu);
+    if (!next_process) next_process = cpu->idle;
 
-    // If no READY process, check for the idle task
     if (!next_process) {
-        for (int i = 0; i < MAX_PROCESSES; i++) {
-            if (process_table[i].priority == 0 && process_table[i].state == READY) {
-                next_process = &process_table[i];
-                break;
-            }
-        }
+        Logger::log(LogLevel::ERROR, "No processes available to execute on CPU %d!", cpu->id);
+        irq_restore(flags);
+        return;
     }
 
-    if (!next_process) {
-        if (old_process->pid != 0)
-            Logger::log(LogLevel::ERROR, "No processes available to execute!");
+    WakeupTracer::running(next_process, now_tsc);
 
-        asm volatile("sti");
-        return;
+    // Dynamic tick: with only the idle task runnable, sleep until the next deadline
+    if (next_process == cpu->idle) {
+        timer_stop_tick(next_timer_event());
+    } else {
+        timer_restart_tick(sched_slice_ms(cpu, next_process));
     }
 
     // Don't switch if it's the same process
     if (next_process == old_process) {
-        asm volatile("sti");
+        old_process->state = RUNNING;
+        irq_restore(flags);
         return;
     }
 
     // Update process states
-    if (old_process && old_process->state == RUNNING) {
+    if (old_process && (old_process->state == RUNNING || old_process->state == READY)) {
         old_process->state = READY;
+        old_process->stats.involuntary++;
+        if (requeue_old) {
+            old_process->stats.ready_since = now_tsc;
+            cpu->runqueue.push(old_process); // Stealers skip it until on_cpu clears
+        }
+    } else if (old_process) {
+        old_process->stats.voluntary++;
+        if (old_process->state == BLOCKED) old_process->stats.blocked_since = now_tsc;
     }
 
-    //term_print("\n");
-    //Logger::log(LogLevel::DEBUG, "Scheduling Thread %d (%s)", next_process->pid, next_process->is_kernel_mode ? "Kernel" : "User");
-
-    uint32_t esp;
-
-    Logger::serial_log("================================\n");
-    
-    asm volatile ("mov %%esp, %0" : "=r"(esp));
-    Logger::serial_log("BEFORE KERNEL ESP: 0x%x \n", esp);
-
-    if (old_process && old_process->pid != 0) {
-        interruptFrame* old_ctx = &old_process->context;    
-        *old_ctx = *interrupt_frame;
-
-        //old_ctx->ss = 0x23;
-        //old_ctx->cs = 0x1B;
-
-        // Calculate stack usage
-        uint32_t stack_usage = (((uint32_t)old_process->user_stack + STACK_SIZE) & ~0xF) - (uint32_t)old_ctx->esp;
-        Logger::serial_log("Stack Usage: %d bytes\n", stack_usage);
-
-        Logger::serial_log("Saved context for process PID %d \n", old_process->pid);
-        print_interrupt_frame(&old_process->context); // Pass the context directly
-        Logger::serial_log("Saved ESP: 0x%x \n", old_process->context.esp);
+    if (next_process->stats.ready_since) {
+        if (now_tsc > next_process->stats.ready_since) next_process->stats.wait += now_tsc - next_process->stats.ready_since;
+        next_process->stats.ready_since = 0;
     }
 
-    //asm volatile ("mov %%esp, %0" : "=r"(esp));
-    //serial_log("AFTER KERNEL ESP: 0x%x \n", esp);
+    next_process->state = RUNNING;  // Mark the next process as RUNNING
+    next_process->cpu = cpu->id;
+    next_process->on_cpu = true;
+    next_process->run_start = now;
+    next_process->exec_start = now_tsc;
+    cpu->current = next_process;
+    cpu->prev = old_process;
+    cpu->switches++;
 
-    // Load the new process's context
-    if (next_process) {
-        
-        Logger::serial_log("Loading process PID %d \n", next_process->pid);
-        print_interrupt_frame(&next_process->context);
+    tss_set_stack(next_process->kernel_stack->top);
+    fpu_switch(old_process, next_process);
+    Tls::switch_to(cpu->id, next_process->tls ? next_process->tls : &cpu->boot_tls);
 
-        Logger::serial_log("Loading ESP: 0x%x \n", next_process->context.esp);
+    Logger::trace<TRACE_DEBUG>(TRACE_SCHED_SWITCH, old_process ? old_process->pid : 0, next_process->pid, next_process->kernel_esp);
 
-        //tss_set_stack(next_process->kernel_stack->top); //not needed for now
-        //Logger::serial_log("TSS Stack set to 0x%x\n", next_process->kernel_stack->top);
-
-        next_process->state = RUNNING;  // Mark the next process as RUNNING
-        current_process = next_process;        
-
-        load_context(&next_process->context); // Load the context of the next process
-    }
+    // The interrupted frame stays on the old thread's kernel stack
+    switch_to(old_process, next_process, interrupt_frame);
 
-    Logger::serial_log("scheduler end reached !?!?");
+    // Back on this thread's stack, possibly on another CPU: cpu is stale here
+    schedule_tail();
+    irq_restore(flags);
 }
 
 void terminate_current_process(int return_code) {
-    if (!current_process || current_process->pid == 0) {  // Don't terminate idle process
+    PerCpu* cpu = this_cpu();
+    PCB* process = cpu->current;
+    if (!process || process == cpu->idle) {  // Don't terminate idle process
         return;
     }
 
-    // Mark as terminated first
-    current_process->state = TERMINATED;
-    
-    // Free process resources
-    if (current_process->kernel_stack) {
-        StackManager::destroy_stack(current_process->kernel_stack);
-        current_process->kernel_stack = nullptr;
-    }
-    if (current_process->user_stack) {
-        StackManager::destroy_stack(current_process->user_stack);
-        current_process->user_stack = nullptr;
-    }
-    if (current_process->fpu_state) {
-        aligned_kfree(current_process->fpu_state);
-        current_process->fpu_state = nullptr;
-    }
+    process->return_code = return_code;
+    process->exiting = true;
+    exit_process(process);
 
-    Logger::log(LogLevel::INFO, "Process PID %d terminated with code %d", current_process->pid, return_code);
-    
-    PCB* terminated = current_process;
-    current_process = nullptr;
-
-    // Force a reschedule
+    // Still on its kernel stack, schedule_tail hands it to the reaper
     schedule(nullptr);
     
     // Should never reach here
     while(1) { asm("hlt"); }
-}
\ No newline at end of file
+}
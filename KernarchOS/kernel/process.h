@@ -4,8 +4,15 @@
 #include "types.h"
 #include "isr.h"
 #include "stack.h"
+#include "percpu.h"
+#include "mlfq.h"
+#include "fair.h"
+#include "edf.h"
+#include "rbtree.h"
 
-#define MAX_PROCESSES 256
+#define MAX_TASKS 4096               // Live at once, see TaskTable
+#define THREAD_STACK_SIZE 8192        // Ring 3 stack
+#define THREAD_KERNEL_STACK_SIZE 8192 // Ring 0 stack, holds the interrupt frames
 
 // GDT Selectors
 #define KERNEL_CODE_SELECTOR 0x08
@@ -18,35 +25,165 @@ enum ProcessState {
     READY,
     RUNNING,
     BLOCKED,
+    ZOMBIE,         // Exited, waiting for the reaper
     TERMINATED
 };
 
-struct Thread;
+// Scheduling classes, in pick order: deadline, MLFQ, fair
+enum SchedPolicy {
+    SCHED_MLFQ,
+    SCHED_FAIR,
+    SCHED_DEADLINE
+};
+
+// Scheduler accounting in TSC cycles, updated at switch time
+struct TaskStats {
+    uint64_t runtime;            // On a CPU
+    uint64_t wait;               // READY in a run queue
+    uint64_t sleep;              // BLOCKED
+    uint32_t voluntary;          // Switched out because it blocked or exited
+    uint32_t involuntary;        // Preempted or yielded while still runnable
+    uint64_t ready_since;        // 0 unless queued
+    uint64_t blocked_since;      // 0 unless blocked
+};
+
+#define TASK_CACHE_LINE 64
 
-typedef struct PCB {
+// One task per thread. Fields are grouped by how often the scheduler
+// touches them: the first cache line holds everything a pick, wakeup or
+// tick reads, the second the fair and deadline class state and what the
+// switch itself needs. The initial register context and the bookkeeping
+// only read at creation, exit or by the shell come after that.
+typedef struct alignas(TASK_CACHE_LINE) PCB {
+    // Line 0: pick, wakeup, tick
     uint32_t pid;
     ProcessState state;
-    uint32_t priority;
-    interrupt_frame context;
+    SchedPolicy policy;
+    uint32_t priority;           // PRIORITY_*, picks the top MLFQ level
+    uint32_t mlfq_level;         // Current MLFQ level, 0 is served first
+    uint32_t cpu;                // CPU it last ran on
+    uint32_t affinity;           // CPU it is pinned to, or CPU_ANY
+    Spinlock lock;               // Orders wakeups against the switch out
+    volatile bool on_cpu;        // Still running, or switching out, on that CPU
+    bool wake_pending;           // Woken while on_cpu, queued once the switch completes
+    bool wq_queued;              // On a wait queue, cleared by the waker
+    bool exiting;                // Asked to exit, the next schedule() makes it a zombie
+    PCB* rq_next;                // Run queue links
+    PCB* rq_prev;
+    uint32_t kernel_esp;         // Saved kernel stack pointer while switched out
+    uint32_t wake_time;          // Sleep deadline in ms
+    int32_t sleep_index;         // Position in the sleep queue, -1 if not queued
+    uint32_t slice_used;         // Milliseconds of the level's allotment used
+    uint32_t run_start;          // When it was last charged or switched in
+
+    // Line 1: fair and deadline classes, switch
+    uint64_t vruntime;           // Weighted cycles run, the fair tree key
+    uint64_t exec_start;         // TSC when it was last charged or switched in
+    uint32_t weight;             // Fair::weight(nice)
+    int32_t nice;                // Fair class only
+    RbNode tree_node;            // Fair or deadline tree link
+    uint32_t dl_abs_deadline;
+    int64_t dl_budget;           // Cycles left in the current job
+    uint8_t* fpu_state;
+    uint32_t fpu_cpu;            // CPU whose FPU registers were last loaded from fpu_state
+    TlsBlock* tls;               // Per-thread block, FS points at it while it runs
+
+    // Cold: creation, exit, accounting
+    alignas(TASK_CACHE_LINE) interrupt_frame context; // Initial frame, copied onto the kernel stack
+    bool context_saved;          // FAST_CONTEXT_SWITCH=0: switched out by copying its frame into context
+    TaskStats stats;
+    uint64_t top_runtime;        // stats.runtime at top's last refresh
+    uint64_t woken_at;           // WakeupTracer: TSC when it became READY, 0 if untraced
+
+    uint32_t dl_runtime;         // Deadline class reservation, all in ms
+    uint32_t dl_deadline;        // Relative to each release
+    uint32_t dl_period;
+    uint32_t dl_release;         // Current job
+    uint32_t dl_misses;          // Jobs that finished late or not at all by their deadline
+    bool dl_missed;              // Current job already counted
+
+    union {
+        void (*entry_void)();                   // void func()
+        void (*entry_void_arg)(const char*);    // void func(const char*)
+        int32_t (*entry_int)();                 // int func()
+        int32_t (*entry_int_arg)(const char*);  // int func(const char*)
+    } entry_point;
+    const char* arg;             // Optional string argument
+    bool has_arg;
+    int32_t return_code;
+    bool joinable;               // Slot kept after exit until join collects it
+    bool exited;                 // Reaped, only return_code is still valid
+    bool fiber_carrier;          // Runs fibers on their own stacks, not on user_stack
+
+    PCB* wq_next;                // Wait queue link
+    PCB* zombie_next;            // Reaper list link
+    PCB* task_next;              // TaskTable live list, or its free cache
+    PCB* task_prev;
+    PCB* pid_next;               // TaskTable PID hash chain
+    bool published;              // In the PID hash and live list
+    Stack* kernel_stack;
+    Stack* user_stack;
     uint32_t base_address;
     uint32_t limit;
     uint32_t *page_table;
-    Stack* kernel_stack;
-    Stack* user_stack;
-    uint8_t* fpu_state;
-    Thread* user_data;
-};
+} PCB;
+
+// Threads are tasks, ThreadManager fills in the thread part of the PCB
+typedef PCB Thread;
 
 void init_processes();
-PCB* create_process(void (*entry_point)());
+void init_idle_process();
+PCB* create_process(void (*entry_point)(), void* arg = nullptr);
+// Stacks, FPU state and TLS block of a task: a pooled shell keeps them
+// across threads, false if memory ran out
+bool alloc_task_resources(PCB* pcb);
+void free_task_resources(PCB* pcb);
 void schedule(interrupt_frame* interrupt_frame);
+// Marks the running process a zombie and switches away, the reaper
+// frees it later
 void terminate_current_process(int return_code = 0);
 
+// Queues a new or woken process on a CPU, kicking that CPU if it idles
+void wake_process(PCB* pcb);
+
+// Changes the priority and restarts from the new top level
+void set_process_priority(PCB* pcb, uint32_t priority);
+
+// Moves a process to the MLFQ or fair class, nice only matters for
+// SCHED_FAIR. Only for processes that are not queued (new or running).
+void set_process_policy(PCB* pcb, SchedPolicy policy, int32_t nice = 0);
+
+// Moves a process to the deadline class, same rules; false if admission
+// control turned the reservation down
+bool set_process_deadline(PCB* pcb, uint32_t runtime_ms, uint32_t deadline_ms, uint32_t period_ms);
+
+// Ends the current deadline job and sleeps until the next release
+void wait_next_period(interrupt_frame* frame);
+
+// Pins a process to one CPU (CPU_ANY to unpin), from its next wakeup on.
+// Deadline threads keep the CPU admission picked.
+void set_process_affinity(PCB* pcb, uint32_t cpu);
+
 void idle_task();
 
-extern "C" void load_context(interrupt_frame* context);
+extern "C" void switch_stacks(uint32_t* prev_esp, uint32_t next_esp);
+extern "C" void save_and_load_context(uint32_t* prev_esp, interrupt_frame* next);
+extern "C" void frame_switch_tail(interrupt_frame* next);
+extern "C" void interrupt_return();
+extern "C" void thread_first_run();
+extern "C" void schedule_tail();
+
+// Position in the pick order, lower runs first: deadline, the MLFQ levels, fair
+#define SCHED_RANK_DEADLINE 0
+#define SCHED_RANK_FAIR     (MLFQ_LEVELS + 1)
+
+static inline uint32_t sched_rank(const PCB* pcb) {
+    if (pcb->policy == SCHED_DEADLINE) return SCHED_RANK_DEADLINE;
+    if (pcb->policy == SCHED_FAIR) return SCHED_RANK_FAIR;
+    return pcb->mlfq_level + 1;
+}
 
-extern PCB process_table[MAX_PROCESSES];
-extern PCB* current_process;
+// The process running on this CPU
+#define current_process (this_cpu_current())
 
 #endif // PROCESS_H
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "rbtree.h"
+
+RbNode* RbTree::next(RbNode* node) {
+    if (node->right) {
+        node = node->right;
+        while (node->left) node = node->left;
+        return node;
+    }
+    while (node->parent && node == node->parent->right) node = node->parent;
+    return node->parent;
+}
+
+void RbTree::replace_child(RbNode* parent, RbNode* old_child, RbNode* new_child) {
+    if (!parent) root = new_child;
+    else if (parent->left == old_child) parent->left = new_child;
+    else parent->right = new_child;
+}
+
+void RbTree::rotate_left(RbNode* node) {
+    RbNode* pivot = node->right;
+    node->right = pivot->left;
+    if (pivot->left) pivot->left->parent = node;
+    pivot->parent = node->parent;
+    replace_child(node->parent, node, pivot);
+    pivot->left = node;
+    node->parent = pivot;
+}
+
+void RbTree::rotate_right(RbNode* node) {
+    RbNode* pivot = node->left;
+    node->left = pivot->right;
+    if (pivot->right) pivot->right->parent = node;
+    pivot->parent = node->parent;
+    replace_child(node->parent, node, pivot);
+    pivot->right = node;
+    node->parent = pivot;
+}
+
+void RbTree::insert_fixup(RbNode* node) {
+    while (node->parent && node->parent->red) {
+        RbNode* parent = node->parent;
+        RbNode* grandparent = parent->parent; // Exists, a red node is never the root
+
+        if (parent == grandparent->left) {
+            RbNode* uncle = grandparent->right;
+            if (uncle && uncle->red) {
+                parent->red = uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->right) {
+                rotate_left(parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rotate_right(grandparent);
+        } else {
+            RbNode* uncle = grandparent->left;
+            if (uncle && uncle->red) {
+                parent->red = uncle->red = false;
+                grandparent->red = true;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->left) {
+                rotate_right(parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            rotate_left(grandparent);
+        }
+    }
+    root->red = false;
+}
+
+void RbTree::erase(RbNode* node) {
+    if (leftmost == node) leftmost = next(node);
+
+    RbNode* child;
+    RbNode* parent;
+    bool removed_red;
+
+    if (node->left && node->right) {
+        // Two children: the in-order successor takes the node's place
+        RbNode* successor = node->right;
+        while (successor->left) successor = successor->left;
+
+        child = successor->right;
+        removed_red = successor->red;
+        if (successor->parent == node) {
+            parent = successor;
+        } else {
+            parent = successor->parent;
+            parent->left = child;
+            if (child) child->parent = parent;
+            successor->right = node->right;
+            node->right->parent = successor;
+        }
+
+        successor->left = node->left;
+        node->left->parent = successor;
+        successor->parent = node->parent;
+        successor->red = node->red;
+        replace_child(node->parent, node, successor);
+    } else {
+        child = node->left ? node->left : node->right;
+        parent = node->parent;
+        removed_red = node->red;
+        if (child) child->parent = parent;
+        replace_child(parent, node, child);
+    }
+
+    if (!removed_red) erase_fixup(child, parent);
+}
+
+// node took the place of a removed black node and is one black short
+void RbTree::erase_fixup(RbNode* node, RbNode* parent) {
+    while (node != root && (!node || !node->red)) {
+        if (node == parent->left) {
+            RbNode* sibling = parent->right;
+            if (sibling->red) {
+                sibling->red = false;
+                parent->red = true;
+                rotate_left(parent);
+                sibling = parent->right;
+            }
+            if ((!sibling->left || !sibling->left->red) && (!sibling->right || !sibling->right->red)) {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+            } else {
+                if (!sibling->right || !sibling->right->red) {
+                    sibling->left->red = false;
+                    sibling->red = true;
+                    rotate_right(sibling);
+                    sibling = parent->right;
+                }
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->right->red = false;
+                rotate_left(parent);
+                node = root;
+            }
+        } else {
+            RbNode* sibling = parent->left;
+            if (sibling->red) {
+                sibling->red = false;
+                parent->red = true;
+                rotate_right(parent);
+                sibling = parent->left;
+            }
+            if ((!sibling->left || !sibling->left->red) && (!sibling->right || !sibling->right->red)) {
+                sibling->red = true;
+                node = parent;
+                parent = node->parent;
+            } else {
+                if (!sibling->left || !sibling->left->red) {
+                    sibling->right->red = false;
+                    sibling->red = true;
+                    rotate_left(sibling);
+                    sibling = parent->left;
+                }
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->left->red = false;
+                rotate_right(parent);
+                node = root;
+            }
+        }
+    }
+    if (node) node->red = false;
+}
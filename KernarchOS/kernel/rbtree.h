@@ -0,0 +1,63 @@
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include "types.h"
+
+// Node embedded in the object it orders
+struct RbNode {
+    RbNode* parent;
+    RbNode* left;
+    RbNode* right;
+    bool red;
+};
+
+// Intrusive red-black tree with a cached leftmost node. Equal keys keep
+// insertion order. All-zero is a valid empty tree.
+class RbTree {
+public:
+    // less(a, b) orders two nodes, usually by a key in the containing object
+    template<typename Less>
+    void insert(RbNode* node, Less less) {
+        RbNode** link = &root;
+        RbNode* parent = nullptr;
+        bool is_leftmost = true;
+
+        while (*link) {
+            parent = *link;
+            if (less(node, parent)) {
+                link = &parent->left;
+            } else {
+                link = &parent->right;
+                is_leftmost = false;
+            }
+        }
+
+        node->parent = parent;
+        node->left = node->right = nullptr;
+        node->red = true;
+        *link = node;
+        if (is_leftmost) leftmost = node;
+
+        insert_fixup(node);
+    }
+
+    void erase(RbNode* node);
+
+    RbNode* first() const { return leftmost; }
+    static RbNode* next(RbNode* node);
+
+private:
+    RbNode* root;
+    RbNode* leftmost;
+
+    void replace_child(RbNode* parent, RbNode* old_child, RbNode* new_child);
+    void rotate_left(RbNode* node);
+    void rotate_right(RbNode* node);
+    void insert_fixup(RbNode* node);
+    void erase_fixup(RbNode* node, RbNode* parent);
+};
+
+// Object containing the node, like Linux's container_of
+#define rb_entry(node, type, member) ((type*)((char*)(node) - __builtin_offsetof(type, member)))
+
+#endif // RBTREE_H
@@ -0,0 +1,61 @@
+#include "reaper.h"
+#include "process.h"
+#include "thread.h"
+#include "stack.h"
+#include "fpu.h"
+#include "logger.h"
+
+WaitQueue Reaper::waiters;
+PCB* Reaper::head;
+uint32_t Reaper::total;
+
+void Reaper::start() {
+    Thread* thread = ThreadManager::create_thread(run, nullptr, false);
+    if (!thread) {
+        Logger::log(LogLevel::ERROR, "Failed to create the reaper thread");
+        return;
+    }
+    // Freeing memory is never urgent, the MLFQ boost keeps it from starving
+    set_process_priority(thread, PRIORITY_BATCH);
+    wake_process(thread);
+}
+
+void Reaper::add(PCB* pcb) {
+    uint32_t flags = waiters.lock_irqsave();
+    pcb->zombie_next = head;
+    head = pcb;
+    waiters.wake_one_locked();
+    waiters.unlock_irqrestore(flags);
+}
+
+void Reaper::run() {
+    while (true) {
+        // Take everything that exited since the last pass
+        PCB* batch = nullptr;
+        waiters.wait_until([&] {
+            batch = head;
+            head = nullptr;
+            return batch != nullptr;
+        });
+
+        while (batch) {
+            PCB* next = batch->zombie_next;
+            reap(batch);
+            batch = next;
+        }
+    }
+}
+
+// The stacks, FPU state and TLS block go back with the task, TaskTable
+// keeps them for the next spawn while its pool has room
+void Reaper::reap(PCB* pcb) {
+    // Its FPU state area is about to be reset for someone else
+    fpu_disown(pcb);
+
+    pcb->zombie_next = nullptr;
+    Logger::trace<TRACE_INFO>(TRACE_TASK_EXIT, pcb->pid, pcb->return_code);
+
+    // Frees the slot, or leaves that to join
+    total++;
+    ThreadManager::reap(pcb);
+}
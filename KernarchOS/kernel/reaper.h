@@ -0,0 +1,32 @@
+#ifndef REAPER_H
+#define REAPER_H
+
+#include "types.h"
+#include "waitqueue.h"
+
+struct PCB;
+
+// Frees exited threads off the scheduler path. schedule() only marks an
+// exiting thread ZOMBIE; once it has switched off its kernel stack the
+// PCB is handed here, and the reaper thread returns it, stacks and all,
+// to the task table in batches with interrupts on.
+class Reaper {
+public:
+    // Creates the reaper thread; zombies queued before then wait for it
+    static void start();
+
+    // A ZOMBIE that is no longer on a CPU, from schedule_tail
+    static void add(PCB* pcb);
+
+    static uint32_t reaped() { return total; }
+
+private:
+    static void run();
+    static void reap(PCB* pcb);
+
+    static WaitQueue waiters; // Its lock also guards the zombie list
+    static PCB* head;
+    static uint32_t total;
+};
+
+#endif // REAPER_H
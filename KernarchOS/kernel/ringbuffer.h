@@ -0,0 +1,189 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include "types.h"
+
+// Bounded lock-free queues of N elements, N a power of two. The indices
+// are free-running 32-bit counters, so they wrap safely. Every queue is
+// zero-initialised and usable right away, both as a global and as a member.
+// None of them disables interrupts. A queue shared with an interrupt
+// handler needs no lock as long as each side keeps to its role.
+
+#define RING_CACHE_LINE 64
+
+// Single producer, single consumer, wait-free. Each index is written by
+// one side only and sits on its own cache line. Each side caches the
+// other's index, so it only touches the shared line when the ring looks
+// full or empty.
+template<typename T, uint32_t N>
+class SpscRing {
+    static_assert(N && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+    // Producer side
+    bool push(const T& value) { return push_batch(&value, 1) == 1; }
+
+    uint32_t push_batch(const T* values, uint32_t count) {
+        uint32_t head = producer.index;
+        uint32_t free = N - (head - producer.cached);
+        if (free < count) {
+            producer.cached = __atomic_load_n(&consumer.index, __ATOMIC_ACQUIRE);
+            free = N - (head - producer.cached);
+        }
+        if (count > free) count = free;
+
+        for (uint32_t i = 0; i < count; i++) slots[(head + i) & (N - 1)] = values[i];
+        __atomic_store_n(&producer.index, head + count, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // Consumer side
+    bool pop(T* value) { return pop_batch(value, 1) == 1; }
+
+    uint32_t pop_batch(T* values, uint32_t count) {
+        uint32_t tail = consumer.index;
+        uint32_t used = consumer.cached - tail;
+        if (used < count) {
+            consumer.cached = __atomic_load_n(&producer.index, __ATOMIC_ACQUIRE);
+            used = consumer.cached - tail;
+        }
+        if (count > used) count = used;
+
+        for (uint32_t i = 0; i < count; i++) values[i] = slots[(tail + i) & (N - 1)];
+        __atomic_store_n(&consumer.index, tail + count, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // Snapshots, exact only from the producer or consumer side
+    uint32_t size() const {
+        return __atomic_load_n(&producer.index, __ATOMIC_ACQUIRE) - __atomic_load_n(&consumer.index, __ATOMIC_ACQUIRE);
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr uint32_t capacity() { return N; }
+
+private:
+    struct alignas(RING_CACHE_LINE) Side {
+        uint32_t index;      // Written by this side only
+        uint32_t cached;     // Its last look at the other side's index
+    };
+
+    Side producer;
+    Side consumer;
+    T slots[N];
+};
+
+// Bounded MPMC queue (Vyukov): every slot carries a sequence number, so
+// producers and consumers each claim a position with one CAS and then
+// hand the slot over with a release store. The sequence is kept relative
+// to the slot index, which lets a zeroed ring start out valid.
+template<typename T, uint32_t N>
+class MpmcRing {
+    static_assert(N && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+    bool push(const T& value) {
+        uint32_t pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        while (true) {
+            Slot* slot = &slots[pos & (N - 1)];
+            int32_t diff = (int32_t)(sequence(slot) - pos);
+            if (diff == 0) {
+                if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    slot->value = value;
+                    publish(slot, pos + 1);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    bool pop(T* value) {
+        uint32_t pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+        while (true) {
+            Slot* slot = &slots[pos & (N - 1)];
+            int32_t diff = (int32_t)(sequence(slot) - (pos + 1));
+            if (diff == 0) {
+                if (__atomic_compare_exchange_n(&dequeue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    *value = slot->value;
+                    publish(slot, pos + N);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Empty
+            } else {
+                pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    // Element by element, a batch may interleave with other producers or consumers
+    uint32_t push_batch(const T* values, uint32_t count) {
+        uint32_t done = 0;
+        while (done < count && push(values[done])) done++;
+        return done;
+    }
+
+    uint32_t pop_batch(T* values, uint32_t count) {
+        uint32_t done = 0;
+        while (done < count && pop(&values[done])) done++;
+        return done;
+    }
+
+    // Approximate while others are pushing or popping
+    uint32_t size() const {
+        return __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED) - __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr uint32_t capacity() { return N; }
+
+protected:
+    struct Slot {
+        uint32_t turn;       // Sequence number minus the slot index
+        T value;
+    };
+
+    uint32_t index_of(Slot* slot) const { return (uint32_t)(slot - slots); }
+
+    uint32_t sequence(Slot* slot) const {
+        return __atomic_load_n(&slot->turn, __ATOMIC_ACQUIRE) + index_of(slot);
+    }
+
+    void publish(Slot* slot, uint32_t next) {
+        __atomic_store_n(&slot->turn, next - index_of(slot), __ATOMIC_RELEASE);
+    }
+
+    alignas(RING_CACHE_LINE) uint32_t enqueue_pos;
+    alignas(RING_CACHE_LINE) uint32_t dequeue_pos;
+    alignas(RING_CACHE_LINE) Slot slots[N];
+};
+
+// Multiple producers, one consumer: the MPMC producer side, and a
+// consumer that owns dequeue_pos outright, so it needs no CAS and a batch
+// pop stops at the first slot that is not yet filled.
+template<typename T, uint32_t N>
+class MpscRing : public MpmcRing<T, N> {
+    typedef MpmcRing<T, N> Base;
+    typedef typename Base::Slot Slot;
+
+public:
+    bool pop(T* value) { return pop_batch(value, 1) == 1; }
+
+    uint32_t pop_batch(T* values, uint32_t count) {
+        uint32_t pos = this->dequeue_pos;
+        uint32_t done = 0;
+        while (done < count) {
+            Slot* slot = &this->slots[(pos + done) & (N - 1)];
+            if (this->sequence(slot) != pos + done + 1) break; // Empty, or still being written
+            values[done] = slot->value;
+            this->publish(slot, pos + done + N);
+            done++;
+        }
+        __atomic_store_n(&this->dequeue_pos, pos + done, __ATOMIC_RELAXED);
+        return done;
+    }
+};
+
+#endif // RINGBUFFER_H
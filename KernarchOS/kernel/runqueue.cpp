@@ -0,0 +1,186 @@
+#include "runqueue.h"
+#include "process.h"
+#include "cpu.h"
+#include "logger.h"
+
+static bool fair_less(RbNode* a, RbNode* b) {
+    return rb_entry(a, PCB, tree_node)->vruntime < rb_entry(b, PCB, tree_node)->vruntime;
+}
+
+static bool deadline_less(RbNode* a, RbNode* b) {
+    return Edf::earlier(rb_entry(a, PCB, tree_node), rb_entry(b, PCB, tree_node));
+}
+
+// Caller holds the lock
+void RunQueue::append(PCB* pcb) {
+    count = count + 1;
+
+    if (pcb->policy == SCHED_DEADLINE) {
+        dl_tree.insert(&pcb->tree_node, deadline_less);
+        dl_count++;
+        return;
+    }
+
+    if (pcb->policy == SCHED_FAIR) {
+        Fair::place(pcb, min_vruntime);
+        fair_tree.insert(&pcb->tree_node, fair_less);
+        fair_weight += pcb->weight;
+        fair_count++;
+        return;
+    }
+
+    uint32_t level = pcb->mlfq_level;
+    pcb->rq_next = nullptr;
+    pcb->rq_prev = tail[level];
+    if (tail[level]) tail[level]->rq_next = pcb;
+    else head[level] = pcb;
+    tail[level] = pcb;
+}
+
+void RunQueue::push(PCB* pcb) {
+    uint32_t flags = lock.lock_irqsave();
+    append(pcb);
+    lock.unlock_irqrestore(flags);
+}
+
+static bool can_take(PCB* pcb, bool stealing) {
+    if (__atomic_load_n(&pcb->on_cpu, __ATOMIC_ACQUIRE)) return false;
+    return !stealing || pcb->affinity == CPU_ANY;
+}
+
+// Caller holds the lock
+PCB* RunQueue::take_first_ready(PCB* prev, bool stealing) {
+    uint32_t max_rank = prev ? sched_rank(prev) : SCHED_RANK_FAIR;
+
+    for (RbNode* node = dl_tree.first(); node; node = RbTree::next(node)) {
+        PCB* pcb = rb_entry(node, PCB, tree_node);
+        if (prev && prev->policy == SCHED_DEADLINE && !Edf::earlier(pcb, prev)) break;
+        if (!can_take(pcb, stealing)) continue;
+
+        dl_tree.erase(node);
+        dl_count--;
+        count = count - 1;
+        return pcb;
+    }
+
+    for (uint32_t level = 0; level < MLFQ_LEVELS && level + 1 <= max_rank; level++) {
+        PCB* pcb = head[level];
+        while (pcb && !can_take(pcb, stealing)) {
+            pcb = pcb->rq_next;
+        }
+        if (!pcb) continue;
+
+        if (pcb->rq_prev) pcb->rq_prev->rq_next = pcb->rq_next;
+        else head[level] = pcb->rq_next;
+        if (pcb->rq_next) pcb->rq_next->rq_prev = pcb->rq_prev;
+        else tail[level] = pcb->rq_prev;
+
+        pcb->rq_next = pcb->rq_prev = nullptr;
+        count = count - 1;
+        return pcb;
+    }
+
+    if (max_rank < SCHED_RANK_FAIR) return nullptr;
+
+    for (RbNode* node = fair_tree.first(); node; node = RbTree::next(node)) {
+        PCB* pcb = rb_entry(node, PCB, tree_node);
+        // In vruntime order, so nothing later is further behind either
+        if (prev && pcb->vruntime >= prev->vruntime) break;
+        if (!can_take(pcb, stealing)) continue;
+
+        if (node == fair_tree.first() && pcb->vruntime > min_vruntime) min_vruntime = pcb->vruntime;
+        fair_tree.erase(node);
+        fair_weight -= pcb->weight;
+        fair_count--;
+        count = count - 1;
+        return pcb;
+    }
+    return nullptr;
+}
+
+// Caller holds the lock. boost and fair_slice_ms trust the per-class
+// counts: each tree is empty exactly when its count is zero, and the
+// MLFQ levels hold whatever the two counts leave of the total.
+void RunQueue::check_counts() const {
+    bool mlfq_queued = false;
+    for (uint32_t level = 0; level < MLFQ_LEVELS; level++) mlfq_queued |= head[level] != nullptr;
+
+    bool consistent = (dl_count == 0) == (dl_tree.first() == nullptr) &&
+                      (fair_count == 0) == (fair_tree.first() == nullptr) &&
+                      dl_count + fair_count <= count &&
+                      (count > dl_count + fair_count) == mlfq_queued;
+    if (consistent) return;
+
+    static bool reported;
+    if (reported) return;
+    reported = true;
+    Logger::log(LogLevel::ERROR, "Run queue counts do not add up: %u queued, %u deadline, %u fair",
+                (uint32_t)count, dl_count, fair_count);
+}
+
+PCB* RunQueue::pop(PCB* prev) {
+    if (count == 0) return nullptr;
+
+    uint32_t flags = lock.lock_irqsave();
+    PCB* pcb = take_first_ready(prev, false);
+    if (pcb) check_counts();
+    lock.unlock_irqrestore(flags);
+    return pcb;
+}
+
+PCB* RunQueue::steal() {
+    if (count == 0) return nullptr;
+
+    uint32_t flags = irq_save();
+    PCB* pcb = nullptr;
+    if (lock.try_lock()) {
+        pcb = take_first_ready(nullptr, true);
+        if (pcb) check_counts();
+        lock.unlock();
+    }
+    irq_restore(flags);
+    return pcb;
+}
+
+void RunQueue::boost() {
+    if (count == fair_count + dl_count) return;
+
+    uint32_t flags = lock.lock_irqsave();
+
+    // Detach every level first, then refile in the old order
+    PCB* lists[MLFQ_LEVELS];
+    for (uint32_t level = 0; level < MLFQ_LEVELS; level++) {
+        lists[level] = head[level];
+        head[level] = tail[level] = nullptr;
+    }
+
+    for (uint32_t level = 0; level < MLFQ_LEVELS; level++) {
+        PCB* pcb = lists[level];
+        while (pcb) {
+            PCB* next = pcb->rq_next;
+            Mlfq::reset(pcb);
+            count = count - 1;
+            append(pcb);
+            pcb = next;
+        }
+    }
+
+    lock.unlock_irqrestore(flags);
+}
+
+void RunQueue::update_min_vruntime(PCB* running) {
+    uint32_t flags = lock.lock_irqsave();
+
+    uint64_t vruntime = running->vruntime;
+    RbNode* first = fair_tree.first();
+    if (first && rb_entry(first, PCB, tree_node)->vruntime < vruntime) {
+        vruntime = rb_entry(first, PCB, tree_node)->vruntime;
+    }
+    if (vruntime > min_vruntime) min_vruntime = vruntime;
+
+    lock.unlock_irqrestore(flags);
+}
+
+uint32_t RunQueue::fair_slice_ms(PCB* pcb) const {
+    return Fair::slice_ms(pcb->weight, fair_weight + pcb->weight, fair_count + 1);
+}
@@ -0,0 +1,61 @@
+#ifndef RUNQUEUE_H
+#define RUNQUEUE_H
+
+#include "types.h"
+#include "spinlock.h"
+#include "mlfq.h"
+#include "rbtree.h"
+
+struct PCB;
+
+// READY processes owned by one CPU: deadline threads in a tree ordered
+// by absolute deadline, one FIFO per MLFQ level and fair threads in a
+// tree ordered by vruntime. Other CPUs only touch it to queue wakeups
+// and to steal work, always under the lock.
+class RunQueue {
+public:
+    // MLFQ threads go to the tail of their level, fair threads are placed
+    // relative to min_vruntime, deadline threads by their deadline
+    void push(PCB* pcb);
+
+    // Best process that is not still switching out on another CPU. With
+    // a still runnable prev, only ones that should preempt it: a higher
+    // class, an earlier deadline, a higher MLFQ level or a tie on its
+    // level, or a fair thread further behind.
+    PCB* pop(PCB* prev = nullptr);
+
+    // Like pop, but gives up instead of waiting for a contended lock and
+    // leaves pinned processes alone
+    PCB* steal();
+
+    // Anti-starvation: moves every queued MLFQ process back to its top level
+    void boost();
+
+    // Lets min_vruntime follow a fair thread that keeps running
+    void update_min_vruntime(PCB* running);
+
+    // Slice for a fair thread about to run here
+    uint32_t fair_slice_ms(PCB* pcb) const;
+
+    uint32_t size() const { return count; }
+
+private:
+    TicketLock lock;
+    PCB* head[MLFQ_LEVELS];
+    PCB* tail[MLFQ_LEVELS];
+    volatile uint32_t count;
+
+    RbTree dl_tree;
+    uint32_t dl_count;
+
+    RbTree fair_tree;
+    uint64_t min_vruntime;   // Never decreases
+    uint32_t fair_weight;    // Sum of the queued fair weights
+    uint32_t fair_count;
+
+    void append(PCB* pcb);
+    PCB* take_first_ready(PCB* prev, bool stealing);
+    void check_counts() const;
+};
+
+#endif // RUNQUEUE_H
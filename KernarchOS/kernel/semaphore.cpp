@@ -0,0 +1,27 @@
+#include "semaphore.h"
+
+void Semaphore::down() {
+    uint32_t flags = waiters.lock_irqsave();
+    if (count > 0) {
+        count = count - 1;
+        waiters.unlock_irqrestore(flags);
+        return;
+    }
+
+    // up() wakes us with its unit
+    waiters.sleep_locked(flags);
+}
+
+bool Semaphore::try_down() {
+    uint32_t flags = waiters.lock_irqsave();
+    bool taken = count > 0;
+    if (taken) count = count - 1;
+    waiters.unlock_irqrestore(flags);
+    return taken;
+}
+
+void Semaphore::up() {
+    uint32_t flags = waiters.lock_irqsave();
+    if (!waiters.wake_thread_locked()) count = count + 1;
+    waiters.unlock_irqrestore(flags);
+}
@@ -0,0 +1,24 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "types.h"
+#include "waitqueue.h"
+
+// Counting semaphore. up() hands its unit directly to the first waiter
+// instead of raising the count, so waiters are served in FIFO order.
+class Semaphore {
+public:
+    void init(uint32_t initial) { count = initial; }
+
+    void down();
+    bool try_down();
+    void up();
+
+    uint32_t value() const { return count; }
+
+private:
+    volatile uint32_t count;
+    WaitQueue waiters;
+};
+
+#endif // SEMAPHORE_H
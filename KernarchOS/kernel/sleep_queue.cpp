@@ -0,0 +1,107 @@
+#include "sleep_queue.h"
+#include "thread.h"
+#include "logger.h"
+
+Thread* SleepQueue::heap[MAX_TASKS];
+uint32_t SleepQueue::count = 0;
+TicketLock SleepQueue::lock;
+
+// Wrap-safe comparison, wake times are 32-bit milliseconds
+bool SleepQueue::before(Thread* a, Thread* b) {
+    return (int32_t)(a->wake_time - b->wake_time) < 0;
+}
+
+void SleepQueue::place(uint32_t index, Thread* thread) {
+    heap[index] = thread;
+    thread->sleep_index = index;
+}
+
+void SleepQueue::sift_up(uint32_t index) {
+    Thread* thread = heap[index];
+    while (index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (!before(thread, heap[parent])) break;
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, thread);
+}
+
+void SleepQueue::sift_down(uint32_t index) {
+    Thread* thread = heap[index];
+    while (true) {
+        uint32_t child = index * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count && before(heap[child + 1], heap[child])) child++;
+        if (!before(heap[child], thread)) break;
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, thread);
+}
+
+bool SleepQueue::insert(Thread* thread) {
+    if (!thread) return false;
+
+    uint32_t flags = lock.lock_irqsave();
+    bool full = count >= MAX_TASKS;
+    bool inserted = !full && thread->sleep_index < 0;
+    if (inserted) {
+        place(count, thread);
+        sift_up(count++);
+    }
+    lock.unlock_irqrestore(flags);
+
+    if (full) Logger::log(LogLevel::ERROR, "Sleep queue full");
+    return inserted;
+}
+
+void SleepQueue::remove(Thread* thread) {
+    if (!thread) return;
+
+    uint32_t flags = lock.lock_irqsave();
+    unlink(thread);
+    lock.unlock_irqrestore(flags);
+}
+
+// Caller holds the lock
+void SleepQueue::unlink(Thread* thread) {
+    if (thread->sleep_index < 0) return;
+
+    uint32_t index = thread->sleep_index;
+    thread->sleep_index = -1;
+    if (--count == index) return;
+
+    // Move the last element into the hole and restore heap order
+    place(index, heap[count]);
+    if (index > 0 && before(heap[index], heap[(index - 1) / 2])) {
+        sift_up(index);
+    } else {
+        sift_down(index);
+    }
+}
+
+Thread* SleepQueue::pop_due(uint32_t now) {
+    if (count == 0) return nullptr;
+
+    uint32_t flags = lock.lock_irqsave();
+    Thread* thread = count ? heap[0] : nullptr;
+    if (thread && (int32_t)(now - thread->wake_time) < 0) thread = nullptr;
+    if (thread) unlink(thread);
+    lock.unlock_irqrestore(flags);
+
+    return thread;
+}
+
+uint32_t SleepQueue::next_wake_time() {
+    if (count == 0) return SLEEP_QUEUE_EMPTY;
+
+    uint32_t flags = lock.lock_irqsave();
+    uint32_t wake_time = count ? heap[0]->wake_time : SLEEP_QUEUE_EMPTY;
+    lock.unlock_irqrestore(flags);
+    return wake_time;
+}
+
+uint32_t SleepQueue::size() {
+    return count;
+}
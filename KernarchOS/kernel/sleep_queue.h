@@ -0,0 +1,41 @@
+#ifndef SLEEP_QUEUE_H
+#define SLEEP_QUEUE_H
+
+#include "types.h"
+#include "process.h"
+#include "spinlock.h"
+
+#define SLEEP_QUEUE_EMPTY 0xFFFFFFFF
+
+struct PCB;
+typedef PCB Thread;
+
+// Binary min-heap of sleeping threads keyed by wake time.
+// The earliest deadline is always at heap[0], so the tick path only
+// touches threads that are actually due. Shared by all CPUs, the public
+// methods take the queue lock themselves.
+class SleepQueue {
+public:
+    static bool insert(Thread* thread);
+    static void remove(Thread* thread);
+
+    // Pops the earliest thread if its wake time has passed, nullptr otherwise
+    static Thread* pop_due(uint32_t now);
+
+    // Earliest wake time in O(1), SLEEP_QUEUE_EMPTY if nobody is sleeping
+    static uint32_t next_wake_time();
+    static uint32_t size();
+
+private:
+    static Thread* heap[MAX_TASKS];
+    static uint32_t count;
+    static TicketLock lock;
+
+    static bool before(Thread* a, Thread* b);
+    static void place(uint32_t index, Thread* thread);
+    static void sift_up(uint32_t index);
+    static void sift_down(uint32_t index);
+    static void unlink(Thread* thread);
+};
+
+#endif // SLEEP_QUEUE_H
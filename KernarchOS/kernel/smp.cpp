@@ -0,0 +1,120 @@
+#include "smp.h"
+#include "apic.h"
+#include "timer.h"
+#include "gdt.h"
+#include "tss.h"
+#include "idt.h"
+#include "fpu.h"
+#include "cpu.h"
+#include "process.h"
+#include "stack.h"
+#include "cstring.h"
+#include "logger.h"
+#include "kernel_config.h"
+
+// Must match MAX_AP_STACKS in smp_trampoline.asm
+#define SMP_MAX_AP_STACKS 16
+static_assert(MAX_CPUS <= SMP_MAX_AP_STACKS, "Not enough trampoline stack slots");
+
+struct TrampolineParams {
+    uint16_t gdt_limit;
+    uint32_t gdt_base;
+    uint16_t reserved;
+    uint32_t cr3;
+    uint32_t entry;
+    uint32_t max_cpus;
+    volatile uint32_t next_cpu;          // Next logical CPU index to hand out
+    uint32_t stacks[SMP_MAX_AP_STACKS];  // Boot stack top for each index
+} __attribute__((packed));
+
+extern "C" uint8_t smp_trampoline_start[];
+extern "C" uint8_t smp_trampoline_params[];
+extern "C" uint8_t smp_trampoline_end[];
+
+static void reschedule_ipi_handler(interrupt_frame* frame) {
+    apic_eoi(); // Acknowledge first, the scheduler may not return
+    this_cpu()->ipis++;
+    schedule(frame);
+}
+
+void smp_send_reschedule(PerCpu* cpu) {
+    if (!apic_available()) return;
+    apic_send_ipi(cpu->apic_id, APIC_ICR_FIXED | INT_IPI_RESCHEDULE);
+}
+
+// First C code on an application processor, still on its boot stack
+extern "C" void ap_main(uint32_t id) {
+    idt_flush((uint32_t)&idt_ptr);
+    tss_init_cpu(id);
+    percpu_init(id);
+
+    apic_init_cpu();
+    this_cpu()->apic_id = apic_id();
+    fpu_init_cpu();
+    timer_init_cpu();
+
+    init_idle_process();
+
+    // Never returns, the boot stack is abandoned on the first switch
+    schedule(nullptr);
+    while (1) asm volatile("hlt");
+}
+
+// Logical processors per package, when CPUID reports it
+static uint32_t smp_expected_cpus() {
+    if (!cpu_has(CPUID_EDX_HTT)) return 0;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t count = (ebx >> 16) & 0xFF;
+    return count < MAX_CPUS ? count : MAX_CPUS;
+}
+
+void smp_init() {
+    this_cpu()->apic_id = apic_available() ? apic_id() : 0;
+    register_interrupt_handler(INT_IPI_RESCHEDULE, reschedule_ipi_handler);
+
+#if SMP
+    // Application processors are driven by their own local APIC timer
+    if (!apic_available() || timer_get_mode() == TIMER_PIT) {
+        Logger::log(LogLevel::INFO, "SMP: no local APIC timer, using the boot processor only");
+        return;
+    }
+
+    memcpy((void*)SMP_TRAMPOLINE_BASE, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+    TrampolineParams* params = (TrampolineParams*)(SMP_TRAMPOLINE_BASE + (smp_trampoline_params - smp_trampoline_start));
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+
+    params->gdt_limit = sizeof(GDTEntry) * GDT_ENTRIES - 1;
+    params->gdt_base = (uint32_t)gdt_entries;
+    params->cr3 = cr3;
+    params->entry = (uint32_t)ap_main;
+    params->next_cpu = 1;
+    params->max_cpus = 1;
+    for (uint32_t i = 1; i < MAX_CPUS; i++) {
+        Stack* stack = StackManager::allocate_stack(SMP_AP_STACK_SIZE);
+        if (!stack) break;
+        params->stacks[i] = stack->top;
+        params->max_cpus = i + 1;
+    }
+
+    // INIT, then two startup IPIs pointing at the trampoline page
+    apic_broadcast_ipi(APIC_ICR_INIT | APIC_ICR_ASSERT | APIC_ICR_LEVEL);
+    timer_udelay(10000);
+    for (int i = 0; i < 2; i++) {
+        apic_broadcast_ipi(APIC_ICR_STARTUP | (SMP_TRAMPOLINE_BASE >> 12));
+        timer_udelay(200);
+    }
+
+    // Without a count from CPUID wait out the whole timeout
+    uint32_t expected = smp_expected_cpus();
+    for (uint32_t waited = 0; waited < SMP_AP_TIMEOUT_MS; waited++) {
+        if (expected && cpu_count >= expected) break;
+        timer_udelay(1000);
+    }
+
+    Logger::log(LogLevel::INFO, "SMP: %d CPUs online (MAX_CPUS %d)", cpu_count, MAX_CPUS);
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include "types.h"
+#include "percpu.h"
+
+// Real-mode startup code is copied here, the SIPI vector is its page number
+#define SMP_TRAMPOLINE_BASE 0x8000
+#define SMP_AP_STACK_SIZE 4096
+// How long the boot processor waits for the APs to check in
+#define SMP_AP_TIMEOUT_MS 200
+
+// Starts the application processors with INIT-SIPI-SIPI
+void smp_init();
+
+// Makes an idle CPU run schedule() to pick up queued work
+void smp_send_reschedule(PerCpu* cpu);
+
+#endif // SMP_H
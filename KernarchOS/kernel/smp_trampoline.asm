@@ -0,0 +1,81 @@
+; Application processor startup. The code is copied to TRAMPOLINE_BASE
+; (below 1 MB) by smp_init and entered in real mode through the startup
+; IPI, so every address is computed relative to that copy.
+
+TRAMPOLINE_BASE equ 0x8000
+MAX_AP_STACKS equ 16
+%define TRAMP(x) (TRAMPOLINE_BASE + ((x) - smp_trampoline_start))
+
+global smp_trampoline_start
+global smp_trampoline_params
+global smp_trampoline_end
+
+section .text
+
+[bits 16]
+smp_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    ; Kernel GDT, filled in by the boot processor
+    o32 lgdt [TRAMP(tramp_gdt)]
+
+    mov eax, cr0
+    or eax, 1                    ; PE
+    mov cr0, eax
+    jmp dword 0x08:TRAMP(.protected)
+
+[bits 32]
+.protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; Same address space as the boot processor
+    mov eax, [TRAMP(tramp_cr3)]
+    mov cr3, eax
+
+    ; SSE as in boot.asm
+    mov eax, cr4
+    or eax, 0x00000600           ; OSFXSR | OSXMMEXCPT
+    mov cr4, eax
+
+    mov eax, cr0
+    and eax, 0xFFFFFFFB          ; Clear EM
+    or eax, 0x80000000           ; PG
+    mov cr0, eax
+    fninit
+
+    ; The APs race through here: each takes the next logical CPU index
+    mov eax, 1
+    lock xadd [TRAMP(tramp_next_cpu)], eax
+    cmp eax, [TRAMP(tramp_max_cpus)]
+    jae .park
+
+    mov esp, [TRAMP(tramp_stacks) + eax * 4]
+    push eax
+    mov ebx, [TRAMP(tramp_entry)]
+    call ebx                     ; ap_main(index), does not return
+
+.park:
+    cli
+    hlt
+    jmp .park
+
+; Parameters, layout matches TrampolineParams in smp.cpp
+align 4
+smp_trampoline_params:
+tramp_gdt:      dw 0             ; GDT limit
+                dd 0             ; GDT base
+                dw 0
+tramp_cr3:      dd 0
+tramp_entry:    dd 0
+tramp_max_cpus: dd 0
+tramp_next_cpu: dd 0
+tramp_stacks:   times MAX_AP_STACKS dd 0
+smp_trampoline_end:
@@ -0,0 +1,44 @@
+#include "softirq.h"
+#include "percpu.h"
+#include "cpu.h"
+
+softirq_handler_t Softirq::handlers[SOFTIRQ_COUNT];
+
+static const char* softirq_names[SOFTIRQ_COUNT] = { "timer", "keyboard" };
+
+void Softirq::open(SoftirqType type, softirq_handler_t handler) {
+    handlers[type] = handler;
+}
+
+void Softirq::raise(SoftirqType type) {
+    PerCpu* cpu = this_cpu();
+    // A single locked or, an interrupt raising another type cannot lose this bit
+    __atomic_or_fetch(&cpu->softirq_pending, 1u << type, __ATOMIC_RELAXED);
+    cpu->softirq_raised[type]++;
+}
+
+void Softirq::run() {
+    PerCpu* cpu = this_cpu();
+    // A nested interrupt leaves the work to the pass it interrupted
+    if (cpu->in_softirq || !cpu->softirq_pending) return;
+    cpu->in_softirq = true;
+
+    for (int round = 0; round < SOFTIRQ_MAX_RESTART && cpu->softirq_pending; round++) {
+        uint32_t pending = cpu->softirq_pending;
+        cpu->softirq_pending = 0;
+
+        irq_enable();
+        for (uint32_t type = 0; type < SOFTIRQ_COUNT; type++) {
+            if (!(pending & (1u << type)) || !handlers[type]) continue;
+            cpu->softirq_runs[type]++;
+            handlers[type]();
+        }
+        irq_disable();
+    }
+
+    cpu->in_softirq = false;
+}
+
+const char* Softirq::name(SoftirqType type) {
+    return type < SOFTIRQ_COUNT ? softirq_names[type] : "?";
+}
@@ -0,0 +1,41 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include "types.h"
+
+// Bottom halves, in the order they run
+enum SoftirqType {
+    SOFTIRQ_TIMER,       // Delayed work expiry
+    SOFTIRQ_KEYBOARD,    // Scancodes from the keyboard IRQ
+    SOFTIRQ_COUNT
+};
+
+// Rounds of newly raised softirqs handled in one interrupt exit, the
+// rest waits for the next one
+#define SOFTIRQ_MAX_RESTART 4
+
+typedef void (*softirq_handler_t)();
+
+// Two-stage interrupt handling. Top halves registered with
+// register_interrupt_handler acknowledge the device, stash what they read
+// and raise a softirq. On interrupt exit the pending softirqs of the CPU
+// run with interrupts enabled, so one pass handles a whole burst. Softirq
+// handlers must not block; the CPU does not switch threads while they
+// run, a reschedule is deferred until they are done.
+class Softirq {
+public:
+    static void open(SoftirqType type, softirq_handler_t handler);
+
+    // Marks it pending on this CPU, from a top half with interrupts off
+    static void raise(SoftirqType type);
+
+    // From isr_handler with interrupts off, returns with them off
+    static void run();
+
+    static const char* name(SoftirqType type);
+
+private:
+    static softirq_handler_t handlers[SOFTIRQ_COUNT];
+};
+
+#endif // SOFTIRQ_H
@@ -0,0 +1,98 @@
+#include "spinlock.h"
+#include "cpu.h"
+
+void Spinlock::lock() {
+    while (__atomic_exchange_n(&locked, 1, __ATOMIC_ACQUIRE)) {
+        // Wait on a plain read so the cache line is not bounced around
+        while (__atomic_load_n(&locked, __ATOMIC_RELAXED)) {
+            asm volatile("pause");
+        }
+    }
+}
+
+bool Spinlock::try_lock() {
+    return !__atomic_load_n(&locked, __ATOMIC_RELAXED) &&
+           !__atomic_exchange_n(&locked, 1, __ATOMIC_ACQUIRE);
+}
+
+void Spinlock::unlock() {
+    __atomic_store_n(&locked, 0, __ATOMIC_RELEASE);
+}
+
+uint32_t Spinlock::lock_irqsave() {
+    uint32_t flags = irq_save();
+    lock();
+    return flags;
+}
+
+void Spinlock::unlock_irqrestore(uint32_t flags) {
+    unlock();
+    irq_restore(flags);
+}
+
+void TicketLock::lock() {
+    uint16_t ticket = __atomic_fetch_add(&tickets.next, 1, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&tickets.owner, __ATOMIC_ACQUIRE) != ticket) {
+        asm volatile("pause");
+    }
+}
+
+bool TicketLock::try_lock() {
+    uint32_t old = __atomic_load_n(&value, __ATOMIC_RELAXED);
+    if ((old & 0xFFFF) != (old >> 16)) return false;
+
+    // Take the next ticket only if nobody else did in the meantime
+    return __atomic_compare_exchange_n(&value, &old, old + 0x10000, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void TicketLock::unlock() {
+    // Only the holder writes owner, wrapping stays inside the 16-bit half
+    __atomic_store_n(&tickets.owner, (uint16_t)(tickets.owner + 1), __ATOMIC_RELEASE);
+}
+
+uint32_t TicketLock::lock_irqsave() {
+    uint32_t flags = irq_save();
+    lock();
+    return flags;
+}
+
+void TicketLock::unlock_irqrestore(uint32_t flags) {
+    unlock();
+    irq_restore(flags);
+}
+
+void McsLock::lock(McsNode* node) {
+    node->next = nullptr;
+    node->locked = 1;
+
+    McsNode* prev = __atomic_exchange_n(&tail, node, __ATOMIC_ACQ_REL);
+    if (!prev) return; // Queue was empty
+
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+        asm volatile("pause");
+    }
+}
+
+bool McsLock::try_lock(McsNode* node) {
+    node->next = nullptr;
+    node->locked = 0;
+
+    McsNode* expected = nullptr;
+    return __atomic_compare_exchange_n(&tail, &expected, node, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void McsLock::unlock(McsNode* node) {
+    McsNode* next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    if (!next) {
+        // No successor yet: release, unless one is just linking itself in
+        McsNode* expected = node;
+        if (__atomic_compare_exchange_n(&tail, &expected, nullptr, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+            asm volatile("pause");
+        }
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,110 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "types.h"
+#include "cpu.h"
+
+// Busy-waiting locks for data shared between CPUs. Holders must not
+// sleep; the irqsave variants also keep interrupt handlers on this CPU
+// from deadlocking against the holder.
+
+// Test-and-test-and-set: cheapest when uncontended, but unfair
+class Spinlock {
+public:
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    uint32_t lock_irqsave();
+    void unlock_irqrestore(uint32_t flags);
+
+    volatile uint32_t locked; // 0 means unlocked, 1 means locked
+};
+
+// Ticket lock: waiters are served in arrival order
+class TicketLock {
+public:
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    uint32_t lock_irqsave();
+    void unlock_irqrestore(uint32_t flags);
+
+    union {
+        volatile uint32_t value;
+        struct {
+            volatile uint16_t owner;  // Ticket being served
+            volatile uint16_t next;   // Next ticket to hand out
+        } tickets;
+    };
+};
+
+// Queue node of an MCS lock, one per acquisition (usually on the stack)
+struct McsNode {
+    McsNode* volatile next;
+    volatile uint32_t locked;
+};
+
+// MCS queue lock: FIFO like the ticket lock, but every waiter spins on
+// its own node, so a handover touches a single remote cache line
+class McsLock {
+public:
+    void lock(McsNode* node);
+    bool try_lock(McsNode* node);
+    void unlock(McsNode* node);
+
+    McsNode* volatile tail;
+};
+
+// Holds a lock for the guard's scope
+template<typename Lock>
+class LockGuard {
+public:
+    explicit LockGuard(Lock& lock) : lock(lock) { lock.lock(); }
+    ~LockGuard() { lock.unlock(); }
+
+    LockGuard(const LockGuard&) = delete;
+    LockGuard& operator=(const LockGuard&) = delete;
+
+private:
+    Lock& lock;
+};
+
+// spin_lock_irqsave for a scope: interrupts stay off on this CPU while held
+template<typename Lock>
+class IrqSaveGuard {
+public:
+    explicit IrqSaveGuard(Lock& lock) : lock(lock) { flags = lock.lock_irqsave(); }
+    ~IrqSaveGuard() { lock.unlock_irqrestore(flags); }
+
+    IrqSaveGuard(const IrqSaveGuard&) = delete;
+    IrqSaveGuard& operator=(const IrqSaveGuard&) = delete;
+
+private:
+    Lock& lock;
+    uint32_t flags;
+};
+
+// MCS lock with interrupts off, the guard carries the queue node
+class McsGuard {
+public:
+    explicit McsGuard(McsLock& lock) : lock(lock) {
+        flags = irq_save();
+        lock.lock(&node);
+    }
+    ~McsGuard() {
+        lock.unlock(&node);
+        irq_restore(flags);
+    }
+
+    McsGuard(const McsGuard&) = delete;
+    McsGuard& operator=(const McsGuard&) = delete;
+
+private:
+    McsLock& lock;
+    McsNode node;
+    uint32_t flags;
+};
+
+#endif // SPINLOCK_H
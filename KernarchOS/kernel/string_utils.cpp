@@ -86,6 +86,13 @@ int double_to_string(double num, char* str, int precision) {
     return i;
 }
 
+// Right-aligns a field of len characters to width with spaces
+static void pad_field(char* buffer, size_t buffer_size, size_t* buffer_index, int len, int width) {
+    while (len++ < width && *buffer_index < buffer_size - 1) {
+        buffer[(*buffer_index)++] = ' ';
+    }
+}
+
 int vformat_string(char* buffer, size_t buffer_size, const char* format, va_list args) {
     size_t buffer_index = 0;
     const char* format_ptr = format;
@@ -98,12 +105,19 @@ int vformat_string(char* buffer, size_t buffer_size, const char* format, va_list
 
         format_ptr++;
 
+        // Optional minimum field width, as in %5u
+        int width = 0;
+        while (*format_ptr >= '0' && *format_ptr <= '9') {
+            width = width * 10 + (*format_ptr++ - '0');
+        }
+
         switch (*format_ptr) {
             case 'd':
             case 'i': {
                 int value = va_arg(args, int);
                 char temp[32];
                 int len = int_to_string(value, temp, 10);
+                pad_field(buffer, buffer_size, &buffer_index, len, width);
                 for (int i = 0; i < len && buffer_index < buffer_size - 1; i++) {
                     buffer[buffer_index++] = temp[i];
                 }
@@ -113,6 +127,7 @@ int vformat_string(char* buffer, size_t buffer_size, const char* format, va_list
                 unsigned int value = va_arg(args, unsigned int);
                 char temp[32];
                 int len = uint_to_string(value, temp, 10);
+                pad_field(buffer, buffer_size, &buffer_index, len, width);
                 for (int i = 0; i < len && buffer_index < buffer_size - 1; i++) {
                     buffer[buffer_index++] = temp[i];
                 }
@@ -123,6 +138,7 @@ int vformat_string(char* buffer, size_t buffer_size, const char* format, va_list
                 unsigned int value = va_arg(args, unsigned int);
                 char temp[32];
                 int len = uint_to_string(value, temp, 16);
+                pad_field(buffer, buffer_size, &buffer_index, len, width);
                 for (int i = 0; i < len && buffer_index < buffer_size - 1; i++) {
                     buffer[buffer_index++] = (*format_ptr == 'X') ? toupper(temp[i]) : temp[i];
                 }
@@ -144,6 +160,7 @@ int vformat_string(char* buffer, size_t buffer_size, const char* format, va_list
             }
             case 's': {
                 const char* value = va_arg(args, const char*);
+                pad_field(buffer, buffer_size, &buffer_index, strlen(value), width);
                 while (*value != '\0' && buffer_index < buffer_size - 1) {
                     buffer[buffer_index++] = *value++;
                 }
@@ -207,4 +224,20 @@ char tolower(char c) {
         return c - 'A' + 'a';
     }
     return c;
-}
\ No newline at end of file
+}
+
+int atoi(const char* s) {
+    int result = 0;
+    int sign = 1;
+
+    while (*s == ' ') s++;
+    if (*s == '-') {
+        sign = -1;
+        s++;
+    }
+    while (*s >= '0' && *s <= '9') {
+        result = result * 10 + (*s - '0');
+        s++;
+    }
+    return result * sign;
+}
@@ -31,5 +31,6 @@ char* strchr(const char* s, int c);
 char* strrchr(const char* s, int c);
 char toupper(char c);
 char tolower(char c);
+int atoi(const char* s);
 
 #endif // STRING_UTILS_H
\ No newline at end of file
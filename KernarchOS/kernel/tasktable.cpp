@@ -0,0 +1,171 @@
+#include "tasktable.h"
+#include "memory.h"
+#include "cstring.h"
+#include "logger.h"
+
+TicketLock TaskTable::lock;
+uint32_t TaskTable::pid_bitmap[PID_MAX / 32];
+uint32_t TaskTable::last_pid = PID_MAX - 1; // The first PID handed out is 0
+PCB* TaskTable::pid_hash[PID_HASH_BUCKETS];
+PCB* TaskTable::head;
+PCB* TaskTable::pool;
+PCB* TaskTable::free_list;
+uint32_t TaskTable::pool_count;
+uint32_t TaskTable::live_count;
+uint32_t TaskTable::allocated_count;
+
+// Next free PID after the last one handed out, a word of the bitmap at a
+// time. With at most MAX_TASKS of PID_MAX in use this rarely looks past
+// the first word.
+uint32_t TaskTable::alloc_pid() {
+    uint32_t pid = last_pid + 1;
+    for (uint32_t scanned = 0; scanned <= PID_MAX / 32; scanned++) {
+        if (pid >= PID_MAX) pid = 0;
+        uint32_t word = pid / 32;
+        uint32_t free = ~pid_bitmap[word] & (~0u << (pid % 32));
+        if (free) {
+            pid = word * 32 + __builtin_ctz(free);
+            pid_bitmap[word] |= 1u << (pid % 32);
+            last_pid = pid;
+            return pid;
+        }
+        pid = (word + 1) * 32;
+    }
+    return PID_NONE;
+}
+
+void TaskTable::free_pid(uint32_t pid) {
+    pid_bitmap[pid / 32] &= ~(1u << (pid % 32));
+}
+
+// Zeroed PCB straight from the heap
+PCB* TaskTable::new_task() {
+    PCB* pcb = (PCB*)aligned_kmalloc(TASK_CACHE_LINE, sizeof(PCB));
+    if (!pcb) return nullptr;
+    memset(pcb, 0, sizeof(PCB));
+    __atomic_add_fetch(&allocated_count, 1, __ATOMIC_RELAXED);
+    return pcb;
+}
+
+// Keeps a released task as a shell while the pool has room, otherwise
+// its resources go back to the heap and only the PCB is kept
+void TaskTable::cache(PCB* pcb) {
+    pcb->state = TERMINATED;
+    pcb->task_prev = nullptr;
+
+    uint32_t flags = lock.lock_irqsave();
+    bool pooled = pcb->kernel_stack && pool_count < TASK_POOL_SIZE;
+    if (pooled) {
+        pcb->task_next = pool;
+        pool = pcb;
+        pool_count++;
+    }
+    lock.unlock_irqrestore(flags);
+    if (pooled) return;
+
+    free_task_resources(pcb);
+    flags = lock.lock_irqsave();
+    pcb->task_next = free_list;
+    free_list = pcb;
+    lock.unlock_irqrestore(flags);
+}
+
+void TaskTable::prefill(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        PCB* pcb = new_task();
+        if (!pcb) return;
+        bool built = alloc_task_resources(pcb);
+        cache(pcb);
+        if (!built) return;
+    }
+}
+
+PCB* TaskTable::allocate() {
+    uint32_t flags = lock.lock_irqsave();
+    uint32_t pid = live_count < MAX_TASKS ? alloc_pid() : PID_NONE;
+    PCB* pcb = nullptr;
+    if (pid != PID_NONE) {
+        live_count++;
+        if (pool) {
+            pcb = pool;
+            pool = pcb->task_next;
+            pool_count--;
+        } else if (free_list) {
+            pcb = free_list;
+            free_list = pcb->task_next;
+        }
+    }
+    lock.unlock_irqrestore(flags);
+
+    if (pid == PID_NONE) {
+        Logger::log(LogLevel::ERROR, "Task table full: %d tasks", MAX_TASKS);
+        return nullptr;
+    }
+
+    // The heap has its own lock, keep it out of the table lock
+    if (!pcb) pcb = new_task();
+    if (!pcb) {
+        flags = lock.lock_irqsave();
+        free_pid(pid);
+        live_count--;
+        lock.unlock_irqrestore(flags);
+        Logger::log(LogLevel::ERROR, "Failed to allocate a task");
+        return nullptr;
+    }
+
+    // A shell keeps its resources, create_process resets them
+    Stack* kernel_stack = pcb->kernel_stack;
+    Stack* user_stack = pcb->user_stack;
+    uint8_t* fpu_state = pcb->fpu_state;
+    TlsBlock* tls = pcb->tls;
+    memset(pcb, 0, sizeof(PCB));
+    pcb->kernel_stack = kernel_stack;
+    pcb->user_stack = user_stack;
+    pcb->fpu_state = fpu_state;
+    pcb->tls = tls;
+
+    pcb->pid = pid;
+    pcb->state = BLOCKED; // Not runnable until wake_process
+    return pcb;
+}
+
+void TaskTable::publish(PCB* pcb) {
+    uint32_t flags = lock.lock_irqsave();
+    uint32_t index = bucket(pcb->pid);
+    pcb->pid_next = pid_hash[index];
+    pid_hash[index] = pcb;
+    pcb->task_next = head;
+    if (head) head->task_prev = pcb;
+    head = pcb;
+    pcb->published = true;
+    lock.unlock_irqrestore(flags);
+}
+
+void TaskTable::release(PCB* pcb) {
+    uint32_t flags = lock.lock_irqsave();
+    // A task whose creation failed was never published
+    if (pcb->published) {
+        PCB** link = &pid_hash[bucket(pcb->pid)];
+        while (*link != pcb) link = &(*link)->pid_next;
+        *link = pcb->pid_next;
+
+        if (pcb->task_prev) pcb->task_prev->task_next = pcb->task_next;
+        else head = pcb->task_next;
+        if (pcb->task_next) pcb->task_next->task_prev = pcb->task_prev;
+        pcb->published = false;
+    }
+
+    free_pid(pcb->pid);
+    live_count--;
+    lock.unlock_irqrestore(flags);
+
+    cache(pcb);
+}
+
+PCB* TaskTable::find(uint32_t pid) {
+    uint32_t flags = lock.lock_irqsave();
+    PCB* pcb = pid_hash[bucket(pid)];
+    while (pcb && pcb->pid != pid) pcb = pcb->pid_next;
+    lock.unlock_irqrestore(flags);
+    return pcb;
+}
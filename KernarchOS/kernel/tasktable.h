@@ -0,0 +1,75 @@
+#ifndef TASKTABLE_H
+#define TASKTABLE_H
+
+#include "types.h"
+#include "spinlock.h"
+#include "process.h"
+
+#define PID_MAX 32768           // PIDs run from 0 to PID_MAX - 1
+#define PID_NONE 0xFFFFFFFF
+#define PID_HASH_BUCKETS 1024   // Power of two
+#define TASK_POOL_SIZE 64       // Released tasks that keep their stacks
+#define TASK_POOL_PREFILL 16    // Shells built at boot
+
+// Owns every task. PCBs are allocated on demand and on release go to a
+// free cache instead of back to the heap, so a stale PCB pointer, such
+// as one held by top, still points at some PCB. PIDs come from a bitmap
+// and are handed out round robin, so a freed PID is only reused after
+// the rest of the PID space has been cycled through. A hash finds a live
+// task by PID, and a list links the live tasks for iteration.
+//
+// Up to TASK_POOL_SIZE released tasks stay whole shells: stacks, FPU
+// state and TLS block attached, so spawning one only resets them and
+// never touches the heap. Released tasks beyond that give them back.
+class TaskTable {
+public:
+    // A zeroed, BLOCKED task with a fresh PID, a pooled shell if there
+    // is one; nullptr when MAX_TASKS tasks are live or memory ran out.
+    // find and for_each only see it once it is published.
+    static PCB* allocate();
+
+    // Makes a fully built task visible to find and for_each
+    static void publish(PCB* pcb);
+
+    // Builds up to count shells ahead of the first spawns
+    static void prefill(uint32_t count);
+
+    // Drops a task that is off every queue and CPU, its PID and memory are reused
+    static void release(PCB* pcb);
+
+    // The live task with that PID, nullptr if there is none
+    static PCB* find(uint32_t pid);
+
+    // Calls f(pcb) on every live task, with the table locked and interrupts off
+    template<typename F>
+    static void for_each(F f) {
+        uint32_t flags = lock.lock_irqsave();
+        for (PCB* pcb = head; pcb; pcb = pcb->task_next) f(pcb);
+        lock.unlock_irqrestore(flags);
+    }
+
+    static uint32_t live() { return live_count; }
+    // PCBs taken from the heap so far, live or cached
+    static uint32_t allocated() { return allocated_count; }
+    static uint32_t pooled() { return pool_count; }
+
+private:
+    static uint32_t alloc_pid();
+    static void free_pid(uint32_t pid);
+    static uint32_t bucket(uint32_t pid) { return pid & (PID_HASH_BUCKETS - 1); }
+    static PCB* new_task();
+    static void cache(PCB* pcb);
+
+    static TicketLock lock;             // Guards everything below
+    static uint32_t pid_bitmap[PID_MAX / 32];
+    static uint32_t last_pid;
+    static PCB* pid_hash[PID_HASH_BUCKETS];
+    static PCB* head;                   // Live tasks
+    static PCB* pool;                   // Released shells, linked through task_next
+    static PCB* free_list;              // Released PCBs without resources
+    static uint32_t pool_count;
+    static uint32_t live_count;
+    static uint32_t allocated_count;
+};
+
+#endif // TASKTABLE_H
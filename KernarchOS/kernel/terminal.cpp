@@ -21,7 +21,8 @@ static uint8_t term_color = DEFAULT_COLOR;  // Initialize with default colors
 static char input_buffer[INPUT_BUFFER_SIZE];
 static size_t input_index = 0;
 
-Mutex mutex;
+// Held only for short screen updates, never across a command
+static TicketLock term_lock;
 
 // Reset terminal state
 static void reset_state() {
@@ -166,21 +167,21 @@ void term_printf_at_input_line(const char* format, ...) {
     va_end(args);
     
     if (length > 0) {
-        mutex.lock();
+        uint32_t flags = term_lock.lock_irqsave();
         const int INPUT_ROW = VGA_ROWS - 1;
         for (int i = 0; i < length && i < VGA_COLS; i++) {
             write_vga(INPUT_ROW, i, buffer[i], term_color);
         }
         input_col = length;
         update_cursor();
-        mutex.unlock();
+        term_lock.unlock_irqrestore(flags);
     }
     
 }
 
 void term_print(const char* str) {
     if (!str) return;
-    mutex.lock();
+    uint32_t flags = term_lock.lock_irqsave();
     const uint8_t saved_color = term_color;  // Save original color
     
     for (size_t i = 0; str[i] != '\0'; i++) {
@@ -203,7 +204,7 @@ void term_print(const char* str) {
     }
     
     term_color = saved_color;  // Restore original color
-    mutex.unlock();
+    term_lock.unlock_irqrestore(flags);
 }
 
 
@@ -234,18 +235,18 @@ void term_printf_fixed(const char* format, ...) {
     va_end(args);
     
     if (length > 0) {
-        mutex.lock();
+        uint32_t flags = term_lock.lock_irqsave();
         const int INPUT_ROW = VGA_ROWS - 2; // Assuming you want to print on the last row
         for (int i = 0; i < length && i < VGA_COLS; i++) {
             if (buffer[i] != '\n' && buffer[i] != '\0')
                 write_vga(INPUT_ROW, i, buffer[i], term_color); // Write to the last row
         }
-        mutex.unlock();
+        term_lock.unlock_irqrestore(flags);
     }
 }
 
 void term_process_command() {
-    mutex.lock();
+    uint32_t flags = term_lock.lock_irqsave();
     // Save terminal state
     const int saved_print_col = print_col;
     const int saved_print_row = print_row;
@@ -256,7 +257,7 @@ void term_process_command() {
     print_row = saved_print_row;
     term_color = saved_color;
     
-    mutex.unlock();
+    term_lock.unlock_irqrestore(flags);
     // Print new prompt
     term_printf_at_input_line("> ");
 
@@ -265,7 +266,7 @@ void term_process_command() {
 }
 
 void term_input(char c) {
-    mutex.lock();
+    uint32_t flags = term_lock.lock_irqsave();
     // Protect against buffer overflow
     if (input_index >= INPUT_BUFFER_SIZE - 1) {
         input_index = 0;  // Reset buffer if it's full
@@ -274,10 +275,10 @@ void term_input(char c) {
     if (c == '\n') {
         input_buffer[input_index] = '\0';
         term_input_putc(c);
-        mutex.unlock();
+        term_lock.unlock_irqrestore(flags);
         
         term_process_command();
-        mutex.lock();
+        flags = term_lock.lock_irqsave();
         input_index = 0;
     } else if (c == '\b') {
         if (input_index > 0) {
@@ -288,12 +289,12 @@ void term_input(char c) {
         input_buffer[input_index++] = c;
         term_input_putc(c);
     }
-   mutex.unlock();
+    term_lock.unlock_irqrestore(flags);
 }
 
 
 void term_clear() {
-    mutex.lock();
+    uint32_t flags = term_lock.lock_irqsave();
     for (int row = 0; row < PRINTABLE_ROWS; row++) {
         for (int col = 0; col < VGA_COLS; col++) {
             write_vga(row, col, ' ', term_color);
@@ -301,5 +302,5 @@ void term_clear() {
     }
     print_col = 0;
     print_row = 0;
-    mutex.unlock();
+    term_lock.unlock_irqrestore(flags);
 }
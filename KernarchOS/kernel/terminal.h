@@ -3,7 +3,7 @@
 
 #include "types.h"
 #include "string_utils.h"
-#include "mutex.h"
+#include "spinlock.h"
 
 enum vga_color {
     VGA_BLACK = 0x0,
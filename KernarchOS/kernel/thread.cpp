@@ -1,60 +1,49 @@
 #include "thread.h"
-#include "pit.h"
+#include "timer.h"
 #include "logger.h"
 #include "interrupts.h"
+#include "sleep_queue.h"
+#include "tasktable.h"
 
+WaitQueue ThreadManager::joiners;
 
 template<typename F>
-Thread* ThreadManager::create_thread(F entry_point, const char* arg) {
-    Thread* thread = new Thread();
-    if (!thread) {
-        Logger::log(LogLevel::ERROR, "Failed to allocate thread structure");
+Thread* ThreadManager::create_thread(F entry_point, const char* arg, bool start) {
+    bool has_arg = (arg != nullptr);
+
+    // Check if the function has an argument and its return type
+    if (has_arg && sizeof(entry_point) != sizeof(void(*)(const char*))) {
+        Logger::log(LogLevel::ERROR, "Invalid function signature for entry point with argument");
         return nullptr;
     }
-
-    // Create process with wrapper as entry point
-    thread->pcb = create_process((void(*)())thread_wrapper);
-    if (!thread->pcb) {
-        delete thread;
+    if (!has_arg && sizeof(entry_point) != sizeof(void(*)())) {
+        Logger::log(LogLevel::ERROR, "Invalid function signature for entry point without argument");
         return nullptr;
     }
 
-    // Determine the function type
-    thread->has_arg = (arg != nullptr);
-    
-    // Check if the function has an argument and its return type
-    if (thread->has_arg) {
-        // Function with argument
-        if (sizeof(entry_point) == sizeof(void(*)(const char*))) { 
-            thread->entry_point.entry_void_arg = (void(*)(const char*))entry_point;
-        } else {
-            Logger::log(LogLevel::ERROR, "Invalid function signature for entry point with argument");
-            delete thread;
-            return nullptr;
-        }
+    // Create process with wrapper as entry point, the task is the thread
+    Thread* thread = create_process(thread_wrapper);
+    if (!thread) return nullptr;
+
+    thread->has_arg = has_arg;
+    if (has_arg) {
+        thread->entry_point.entry_void_arg = (void(*)(const char*))entry_point;
     } else {
-        // Function without argument
-        if (sizeof(entry_point) == sizeof(void(*)())) {
-            thread->entry_point.entry_void = (void(*)())entry_point;
-        } else {
-            Logger::log(LogLevel::ERROR, "Invalid function signature for entry point without argument");
-            delete thread;
-            return nullptr;
-        }
+        thread->entry_point.entry_void = (void(*)())entry_point;
     }
-
     thread->arg = arg;
-    thread->state = THREAD_READY;
-    thread->wake_time = 0;
     thread->return_code = 0;
-    thread->pcb->user_data = thread;
+    thread->joinable = false;
+    thread->exited = false;
 
-    Logger::log(LogLevel::DEBUG, "Created thread for PID %d", thread->pcb->pid);
+    // Fully set up before any CPU can pick it
+    if (start) wake_process(thread);
     return thread;
 }
 
+// Runs on the new thread, which finds itself through FS
 void ThreadManager::thread_wrapper() {
-    Thread* thread = (Thread*)current_process->user_data;
+    Thread* thread = get_current_thread();
     if (!thread) {
         Logger::log(LogLevel::ERROR, "Invalid thread");
         ThreadManager::exit_thread(-1);
@@ -70,70 +59,88 @@ void ThreadManager::thread_wrapper() {
         ret_code = thread->entry_point.entry_int();
     }
 
-    thread->state = THREAD_TERMINATED;
-    thread->return_code = ret_code;
+    ThreadManager::exit_thread(ret_code);
+}
+
+// Explicit template instantiations
+template Thread* ThreadManager::create_thread<void(*)()>(void(*)(), const char*, bool);
+template Thread* ThreadManager::create_thread<void(*)(const char*)>(void(*)(const char*), const char*, bool);
+template Thread* ThreadManager::create_thread<int(*)()>(int(*)(), const char*, bool);
+template Thread* ThreadManager::create_thread<int(*)(const char*)>(int(*)(const char*), const char*, bool);
+
+// The next schedule() turns the thread into a zombie and switches away
+void ThreadManager::exit_thread(int32_t return_code) {
+    Thread* thread = get_current_thread();
+    if (!thread) return;
 
+    thread->return_code = return_code;
+    thread->exiting = true;
     sys_schedule();
-    
+
     // Should never reach here as scheduler will pick a new process
     while(1) { asm("hlt"); }
 }
 
-// Explicit template instantiations
-template Thread* ThreadManager::create_thread<void(*)()>(void(*)(), const char*);
-template Thread* ThreadManager::create_thread<void(*)(const char*)>(void(*)(const char*), const char*);
-template Thread* ThreadManager::create_thread<int(*)()>(int(*)(), const char*);
-template Thread* ThreadManager::create_thread<int(*)(const char*)>(int(*)(const char*), const char*);
+void ThreadManager::set_joinable(Thread* thread) {
+    thread->joinable = true;
+}
 
-void ThreadManager::exit_thread(int32_t return_code) {
-    if (!current_process) return;
+int32_t ThreadManager::join(Thread* thread) {
+    if (!thread || !thread->joinable) return -1;
 
-    Thread* thread = (Thread*)current_process->user_data;
-    if (!thread) return;
+    joiners.wait_until([&] { return thread->exited; });
+    int32_t return_code = thread->return_code;
+    TaskTable::release(thread);
+    return return_code;
+}
 
-    if (return_code != 0)
-        thread->return_code = return_code;
-    
-    delete current_process->user_data;
-    // Clear the user data before process termination
-    current_process->user_data = nullptr;
-    
-    // Now terminate the process with return code
-    terminate_current_process(thread->return_code);
+void ThreadManager::reap(Thread* thread) {
+    if (!thread->joinable) {
+        TaskTable::release(thread);
+        return;
+    }
+
+    uint32_t flags = joiners.lock_irqsave();
+    thread->exited = true;
+    joiners.unlock_irqrestore(flags);
+    joiners.wake_all();
 }
 
 void ThreadManager::sleep(uint32_t milliseconds) {
     sys_sleep(milliseconds);
 }
 
+// Puts the current thread to sleep; the caller is expected to reschedule
+void ThreadManager::sleep_current(uint32_t milliseconds) {
+    Thread* thread = get_current_thread();
+    if (!thread) return;
+
+    thread->state = BLOCKED;
+    thread->wake_time = get_current_time_ms() + milliseconds;
+    SleepQueue::insert(thread);
+}
+
+// Only threads whose deadline has passed are touched
 void ThreadManager::update_sleeping_threads() {
     uint32_t current_time = get_current_time_ms();
 
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (process_table[i].state != TERMINATED) {
-            Thread* thread = (Thread*)process_table[i].user_data;
-            if (thread && thread->state == THREAD_SLEEPING) {
-                if (current_time >= thread->wake_time) {
-                    thread->state = THREAD_READY;
-                    process_table[i].state = READY;
-                }
-            }
-        }
+    Thread* thread;
+    while ((thread = SleepQueue::pop_due(current_time)) != nullptr) {
+        Logger::trace<TRACE_DEBUG>(TRACE_THREAD_WAKE, thread->pid, thread->wake_time, current_time);
+        wake_process(thread);
     }
 }
 
 Thread* ThreadManager::get_current_thread() {
-    if (!current_process) return nullptr;
-    return (Thread*)current_process->user_data;
+    return this_thread();
 }
 
+// Alive and not waiting for anything
 bool ThreadManager::is_thread_ready(Thread* thread) {
     if (!thread) return false;
-    return thread->state == THREAD_READY || 
-           (thread->state == THREAD_SLEEPING && 
-            get_current_time_ms() >= thread->wake_time);
+    return thread->state == READY || thread->state == RUNNING;
 }
 
 void thread_sleep(uint32_t milliseconds) {
     ThreadManager::sleep(milliseconds);
-}
\ No newline at end of file
+}
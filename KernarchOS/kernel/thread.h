@@ -3,37 +3,27 @@
 
 #include "types.h"
 #include "process.h"
-
-enum ThreadState {
-    THREAD_READY,
-    THREAD_RUNNING,
-    THREAD_SLEEPING,
-    THREAD_TERMINATED
-};
-
-struct Thread {
-    PCB* pcb;                    // Process Control Block
-    union {
-        void (*entry_void)();           // void func()
-        void (*entry_void_arg)(const char*); // void func(const char*)
-        int32_t  (*entry_int)();            // int func()
-        int32_t  (*entry_int_arg)(const char*);  // int func(const char*)
-    } entry_point;
-    const char* arg;             // Optional string argument
-    uint32_t wake_time;          // Time to wake up (for sleep)
-    ThreadState state;           // Thread state
-    bool has_arg;
-    int32_t return_code;
-};
+#include "waitqueue.h"
 
 class ThreadManager {
 public:    
     // Specialized thread creation functions
+    // The thread is queued right away unless start is false
     template<typename F>
-    static Thread* create_thread(F entry_point, const char* arg = nullptr);
+    static Thread* create_thread(F entry_point, const char* arg = nullptr, bool start = true);
     
     static void exit_thread(int32_t return_code = 0);
+
+    // Must be called before the thread is started; its slot then
+    // outlives the thread and has to be collected with join
+    static void set_joinable(Thread* thread);
+    // Blocks until a joinable thread has been reaped, frees its slot
+    // and returns its return code
+    static int32_t join(Thread* thread);
+    // From the reaper: frees the slot or hands it to join
+    static void reap(Thread* thread);
     static void sleep(uint32_t milliseconds);
+    static void sleep_current(uint32_t milliseconds);
     static void update_sleeping_threads();
     
     static Thread* get_current_thread();
@@ -41,6 +31,8 @@ public:
 
 private:
     static void thread_wrapper();
+
+    static WaitQueue joiners;
 };
 
 void thread_sleep(uint32_t milliseconds);
@@ -0,0 +1,219 @@
+#include "timer.h"
+#include "pit.h"
+#include "apic.h"
+#include "cpu.h"
+#include "math64.h"
+#include "logger.h"
+#include "sleep_queue.h"
+#include "percpu.h"
+#include "softirq.h"
+#include "workqueue.h"
+#include "kernel_config.h"
+
+// TSC cycles are converted to milliseconds as (cycles * mult) >> shift
+#define TSC_MS_SHIFT 42
+// mult = 2^shift / tsc_khz only fits in 32 bits above this rate
+#define TSC_MS_MIN_KHZ (1u << (TSC_MS_SHIFT - 32))
+
+static TimerMode timer_mode = TIMER_PIT;
+static uint32_t timer_frequency = 0;
+static void (*scheduler_callback)(interrupt_frame* interrupt_frame) = nullptr;
+
+static uint32_t apic_ticks_per_ms = 0;
+static volatile uint32_t apic_periodic_ticks = 0;
+
+// Clock state once the PIT stops being the time source
+static uint32_t time_base_ms = 0;
+static uint64_t tsc_base = 0;
+static uint32_t tsc_ms_mult = 0;
+
+static const char* timer_mode_names[] = {
+    "PIT", "APIC periodic", "APIC one-shot", "APIC TSC-deadline"
+};
+
+uint32_t get_current_time_ms() {
+    switch (timer_mode) {
+        case TIMER_PIT:
+            return pit_get_time_ms();
+        case TIMER_APIC_PERIODIC:
+            return time_base_ms + (apic_periodic_ticks * 1000) / timer_frequency;
+        default:
+            return time_base_ms + (uint32_t)mul_u64_u32_shr(rdtsc() - tsc_base, tsc_ms_mult, TSC_MS_SHIFT);
+    }
+}
+
+// Programs the next event of a one-shot style device
+static void timer_arm(uint32_t deadline_ms) {
+    int32_t delta_ms = (int32_t)(deadline_ms - get_current_time_ms());
+    if (delta_ms < 1) delta_ms = 1;
+
+    if (timer_mode == TIMER_APIC_TSC_DEADLINE) {
+        apic_timer_deadline(rdtsc() + (uint64_t)delta_ms * cpu_info.tsc_khz);
+    } else {
+        uint32_t max_ms = 0xFFFFFFFF / apic_ticks_per_ms;
+        if ((uint32_t)delta_ms > max_ms) delta_ms = max_ms;
+        apic_timer_oneshot(delta_ms * apic_ticks_per_ms);
+    }
+}
+
+static bool timer_is_oneshot() {
+    return timer_mode == TIMER_APIC_ONESHOT || timer_mode == TIMER_APIC_TSC_DEADLINE;
+}
+
+// Earliest of the slice end, the next sleeper deadline and delayed work
+static uint32_t timer_next_event() {
+    uint32_t next = this_cpu()->slice_end;
+    uint32_t next_wake = SleepQueue::next_wake_time();
+    if (next_wake != SLEEP_QUEUE_EMPTY && (int32_t)(next_wake - next) < 0) {
+        next = next_wake;
+    }
+    uint32_t next_due = WorkQueue::next_due();
+    if (next_due != SLEEP_QUEUE_EMPTY && (int32_t)(next_due - next) < 0) {
+        next = next_due;
+    }
+    return next;
+}
+
+// Bottom half of the tick: delayed work that has come due
+static void timer_softirq() {
+    WorkQueue::expire(get_current_time_ms());
+}
+
+static void apic_timer_handler(interrupt_frame* frame) {
+    apic_eoi(); // Acknowledge first, the scheduler may not return
+    // Every CPU ticks, the boot processor alone keeps time
+    if (timer_mode == TIMER_APIC_PERIODIC && this_cpu()->id == 0) apic_periodic_ticks = apic_periodic_ticks + 1;
+    timer_event(frame, timer_is_oneshot());
+}
+
+void timer_event(interrupt_frame* frame, bool force) {
+    uint32_t now = get_current_time_ms();
+    uint32_t next_wake = SleepQueue::next_wake_time();
+    bool sleeper_due = next_wake != SLEEP_QUEUE_EMPTY && (int32_t)(now - next_wake) >= 0;
+    bool slice_expired = (int32_t)(now - this_cpu()->slice_end) >= 0;
+
+    uint32_t next_due = WorkQueue::next_due();
+    if (next_due != SLEEP_QUEUE_EMPTY && (int32_t)(now - next_due) >= 0) {
+        Softirq::raise(SOFTIRQ_TIMER);
+    }
+
+    if (scheduler_callback && (force || sleeper_due || slice_expired)) {
+        scheduler_callback(frame);
+        return;
+    }
+
+    if (timer_is_oneshot()) timer_arm(timer_next_event());
+}
+
+void timer_stop_tick(uint32_t wake_time_ms) {
+    this_cpu()->slice_end = get_current_time_ms() + SCHEDULER_SLICE_MS;
+
+#if TICKLESS_IDLE
+    if (timer_mode == TIMER_PIT) {
+        pit_stop_tick(wake_time_ms);
+    } else if (timer_is_oneshot()) {
+        // The TSC keeps time, so without sleepers no event is needed at all
+        if (wake_time_ms == SLEEP_QUEUE_EMPTY) apic_timer_stop();
+        else timer_arm(wake_time_ms);
+    }
+#else
+    if (timer_is_oneshot()) timer_arm(timer_next_event());
+#endif
+}
+
+void timer_restart_tick(uint32_t slice_ms) {
+    this_cpu()->slice_end = get_current_time_ms() + slice_ms;
+
+    if (timer_mode == TIMER_PIT) {
+        pit_restart_tick();
+    } else if (timer_is_oneshot()) {
+        timer_arm(timer_next_event());
+    }
+}
+
+static TimerMode timer_select_mode() {
+    if (cpu_info.tsc_khz <= TSC_MS_MIN_KHZ) return TIMER_APIC_PERIODIC;
+    if (cpu_has_ecx(CPUID_ECX_TSC_DEADLINE)) return TIMER_APIC_TSC_DEADLINE;
+    return TIMER_APIC_ONESHOT;
+}
+
+void timer_init(uint32_t frequency) {
+    timer_frequency = frequency;
+    Softirq::open(SOFTIRQ_TIMER, timer_softirq);
+
+    // The PIT runs first: it is the fallback clock and the calibration reference
+    pit_init(frequency);
+
+#if APIC_TIMER
+    if (!apic_init()) {
+        Logger::log(LogLevel::INFO, "Scheduler clock: PIT at %d Hz", frequency);
+        return;
+    }
+
+    uint64_t tsc_delta = 0;
+    apic_ticks_per_ms = apic_timer_calibrate(TIMER_CALIBRATION_MS, &tsc_delta) / TIMER_CALIBRATION_MS;
+    if (apic_ticks_per_ms == 0) {
+        Logger::log(LogLevel::WARNING, "APIC timer calibration failed, keeping the PIT");
+        return;
+    }
+    if (cpu_has(CPUID_EDX_TSC)) {
+        cpu_info.tsc_khz = (uint32_t)tsc_delta / TIMER_CALIBRATION_MS;
+    }
+
+    TimerMode mode = timer_select_mode();
+    if (mode != TIMER_APIC_PERIODIC) {
+        tsc_ms_mult = (uint32_t)div64((uint64_t)1 << TSC_MS_SHIFT, cpu_info.tsc_khz);
+    }
+
+    // Hand timekeeping over without losing the time counted so far
+    time_base_ms = pit_get_time_ms();
+    tsc_base = rdtsc();
+    pit_disable();
+
+    timer_mode = mode;
+    register_interrupt_handler(INT_APIC_TIMER, apic_timer_handler);
+    timer_init_cpu();
+
+    Logger::log(LogLevel::INFO, "Scheduler clock: %s, %d APIC ticks/ms, TSC %d kHz",
+                timer_mode_name(), apic_ticks_per_ms, cpu_info.tsc_khz);
+#else
+    Logger::log(LogLevel::INFO, "Scheduler clock: PIT at %d Hz", frequency);
+#endif
+}
+
+// Programs this CPU's local APIC timer with the mode picked at boot
+void timer_init_cpu() {
+    if (timer_mode == TIMER_PIT) return;
+
+    if (timer_mode == TIMER_APIC_PERIODIC) {
+        apic_timer_set_mode(APIC_TIMER_PERIODIC);
+        apic_timer_periodic(apic_ticks_per_ms * 1000 / timer_frequency);
+    } else {
+        apic_timer_set_mode(timer_mode == TIMER_APIC_TSC_DEADLINE ? APIC_TIMER_TSC_DEADLINE : APIC_TIMER_ONESHOT);
+    }
+}
+
+// Busy-waits, for hardware sequences that need short fixed delays
+void timer_udelay(uint32_t us) {
+    if (cpu_info.tsc_khz) {
+        uint64_t end = rdtsc() + div64((uint64_t)us * cpu_info.tsc_khz, 1000);
+        while (rdtsc() < end) asm volatile("pause");
+        return;
+    }
+
+    // Without a calibrated TSC round up to whole PIT milliseconds
+    pit_calibration_start((us + 999) / 1000);
+    while (!pit_calibration_done()) asm volatile("pause");
+}
+
+TimerMode timer_get_mode() {
+    return timer_mode;
+}
+
+const char* timer_mode_name() {
+    return timer_mode_names[timer_mode];
+}
+
+void timer_register_scheduler(void (*scheduler_func)(interrupt_frame* interrupt_frame)) {
+    scheduler_callback = scheduler_func;
+}
@@ -0,0 +1,40 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+#include "isr.h"
+
+// Time slice of the top MLFQ level, lower levels get multiples of it
+#define SCHEDULER_SLICE_MS 10
+// PIT window used to calibrate the local APIC timer and TSC
+#define TIMER_CALIBRATION_MS 10
+
+// Scheduler clock device, chosen at boot from CPUID
+enum TimerMode {
+    TIMER_PIT,
+    TIMER_APIC_PERIODIC,
+    TIMER_APIC_ONESHOT,
+    TIMER_APIC_TSC_DEADLINE
+};
+
+void timer_init(uint32_t frequency);
+void timer_init_cpu();  // Local timer of an application processor
+void timer_udelay(uint32_t us);
+TimerMode timer_get_mode();
+const char* timer_mode_name();
+
+// Called by the clock device on every interrupt; force means the
+// programmed event itself expired (one-shot style devices)
+void timer_event(interrupt_frame* frame, bool force);
+
+// Dynamic tick control, used by the scheduler when it picks the idle task
+// (stop until wake_time_ms, or SLEEP_QUEUE_EMPTY) and when it picks real
+// work that may run for slice_ms
+void timer_stop_tick(uint32_t wake_time_ms);
+void timer_restart_tick(uint32_t slice_ms);
+
+uint32_t get_current_time_ms();
+
+void timer_register_scheduler(void (*scheduler_func)(interrupt_frame* interrupt_frame));
+
+#endif // TIMER_H
@@ -0,0 +1,56 @@
+#include "tls.h"
+#include "gdt.h"
+#include "memory.h"
+#include "cstring.h"
+#include "logger.h"
+
+uint32_t Tls::next_offset = __builtin_offsetof(TlsBlock, data);
+
+TlsBlock* Tls::create() {
+    TlsBlock* block = (TlsBlock*)kmalloc(sizeof(TlsBlock));
+    if (!block) {
+        Logger::log(LogLevel::ERROR, "Failed to allocate a TLS block");
+        return nullptr;
+    }
+    reset(block);
+    return block;
+}
+
+void Tls::reset(TlsBlock* block) {
+    memset(block, 0, sizeof(TlsBlock));
+    block->self = block;
+}
+
+void Tls::destroy(TlsBlock* block) {
+    if (block) kfree(block);
+}
+
+void Tls::init_cpu(uint32_t cpu, TlsBlock* boot) {
+    boot->self = boot;
+    boot->thread = nullptr;
+    gdt_set_gate(GDT_TLS_ENTRY(cpu), (uint32_t)boot, sizeof(TlsBlock) - 1, 0xF2, 0x40);
+    asm volatile("mov %0, %%fs" : : "r"((uint16_t)TLS_SEG(cpu)));
+}
+
+void Tls::switch_to(uint32_t cpu, TlsBlock* block) {
+    // Only the base changes, and the reload below picks it up
+    GDTEntry* entry = &gdt_entries[GDT_TLS_ENTRY(cpu)];
+    uint32_t base = (uint32_t)block;
+    entry->base_low = base & 0xFFFF;
+    entry->base_middle = (base >> 16) & 0xFF;
+    entry->base_high = (base >> 24) & 0xFF;
+    asm volatile("mov %0, %%fs" : : "r"((uint16_t)TLS_SEG(cpu)) : "memory");
+}
+
+uint32_t Tls::reserve(uint32_t size, uint32_t align) {
+    uint32_t old = __atomic_load_n(&next_offset, __ATOMIC_RELAXED);
+    uint32_t at;
+    do {
+        at = (old + align - 1) & ~(align - 1);
+        if (at + size > sizeof(TlsBlock)) {
+            Logger::log(LogLevel::ERROR, "TLS is full, %d bytes requested", size);
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&next_offset, &old, at + size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return at;
+}
@@ -0,0 +1,82 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include "types.h"
+
+#define TLS_SIZE 512    // Whole block, header included
+
+struct PCB;
+typedef PCB Thread;
+
+// Per-thread storage reached through FS. GS already holds the per-CPU
+// block, so every CPU has a second descriptor, loaded in FS, whose base
+// schedule() points at the incoming thread's block. FS is never restored
+// from an interrupt frame, so it is right after a migration too.
+struct TlsBlock {
+    TlsBlock* self;     // %fs:0
+    Thread* thread;     // %fs:4
+    uint8_t data[TLS_SIZE - 8];
+};
+
+class Tls {
+public:
+    // Zeroed block for a new thread, nullptr if out of memory
+    static TlsBlock* create();
+    // Zeroes a block for reuse by another thread
+    static void reset(TlsBlock* block);
+    static void destroy(TlsBlock* block);
+
+    // Points the CPU's FS at its boot block, used until the first switch
+    static void init_cpu(uint32_t cpu, TlsBlock* boot);
+    // From schedule(), before switching to the thread owning block
+    static void switch_to(uint32_t cpu, TlsBlock* block);
+
+    // Offset of a new variable in every block's data, 0 once full
+    static uint32_t reserve(uint32_t size, uint32_t align);
+    static uint32_t used() { return next_offset; }
+
+private:
+    static uint32_t next_offset;
+};
+
+static inline TlsBlock* this_tls() {
+    TlsBlock* block;
+    asm volatile("mov %%fs:0, %0" : "=r"(block));
+    return block;
+}
+
+// The running thread in a single instruction, nullptr on a boot block
+static inline Thread* this_thread() {
+    Thread* thread;
+    asm volatile("mov %%fs:4, %0" : "=r"(thread));
+    return thread;
+}
+
+// A kernel variable with one instance per thread, like thread_local. The
+// space is taken from every TLS block the first time it is used, and new
+// threads start with it zeroed, so T must be fine zero-initialised.
+template<typename T>
+class ThreadLocal {
+public:
+    T* get() {
+        uint32_t at = __atomic_load_n(&offset, __ATOMIC_ACQUIRE);
+        if (!at) at = claim();
+        return at ? (T*)((uint8_t*)this_tls() + at) : nullptr;
+    }
+
+    T* operator->() { return get(); }
+    T& operator*() { return *get(); }
+
+private:
+    uint32_t claim() {
+        uint32_t at = Tls::reserve(sizeof(T), alignof(T));
+        uint32_t expected = 0;
+        // Another thread may have claimed it meanwhile, its offset wins
+        if (!__atomic_compare_exchange_n(&offset, &expected, at, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return expected;
+        return at;
+    }
+
+    uint32_t offset;    // From the block start, 0 until first use
+};
+
+#endif // TLS_H
@@ -0,0 +1,42 @@
+#include "trace.h"
+#include "cpu.h"
+
+TraceRecord TraceBuffer::records[TRACE_BUFFER_SIZE];
+volatile uint32_t TraceBuffer::head = 0;
+
+static const char* trace_event_names[TRACE_EVENT_COUNT] = {
+    "sched_switch", "thread_wake", "task_create", "task_exit"
+};
+
+void TraceBuffer::record(uint32_t event, uint32_t arg0, uint32_t arg1, uint32_t arg2) {
+    uint32_t slot = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED) & (TRACE_BUFFER_SIZE - 1);
+    TraceRecord* record = &records[slot];
+    record->tsc = rdtsc();
+    record->event = event;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+}
+
+void TraceBuffer::clear() {
+    head = 0;
+}
+
+uint32_t TraceBuffer::total() {
+    return head;
+}
+
+uint32_t TraceBuffer::available() {
+    return head < TRACE_BUFFER_SIZE ? head : TRACE_BUFFER_SIZE;
+}
+
+bool TraceBuffer::get(uint32_t index, TraceRecord* record) {
+    if (index >= available()) return false;
+    uint32_t oldest = head - available();
+    *record = records[(oldest + index) & (TRACE_BUFFER_SIZE - 1)];
+    return true;
+}
+
+const char* TraceBuffer::event_name(uint32_t event) {
+    return event < TRACE_EVENT_COUNT ? trace_event_names[event] : "unknown";
+}
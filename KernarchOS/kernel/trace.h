@@ -0,0 +1,49 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include "kernel_config.h"
+
+// Trace levels, Logger::trace calls above KERNEL_TRACE_LEVEL compile to nothing
+enum TraceLevel {
+    TRACE_OFF,
+    TRACE_INFO,
+    TRACE_DEBUG,
+    TRACE_VERBOSE
+};
+
+enum TraceEvent {
+    TRACE_SCHED_SWITCH,     // old pid, new pid, new esp
+    TRACE_THREAD_WAKE,      // pid, wake time, now
+    TRACE_TASK_CREATE,      // pid, eip, 1 if from the pool
+    TRACE_TASK_EXIT,        // pid, return code
+    TRACE_EVENT_COUNT
+};
+
+struct TraceRecord {
+    uint64_t tsc;
+    uint32_t event;
+    uint32_t args[3];
+};
+
+#define TRACE_BUFFER_SIZE 512 // Must be a power of two
+
+// Binary ring buffer, the newest records overwrite the oldest
+class TraceBuffer {
+public:
+    static void record(uint32_t event, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+    static void clear();
+
+    // Records still held, oldest first
+    static uint32_t available();
+    static bool get(uint32_t index, TraceRecord* record);
+    static uint32_t total();
+
+    static const char* event_name(uint32_t event);
+
+private:
+    static TraceRecord records[TRACE_BUFFER_SIZE];
+    static volatile uint32_t head;
+};
+
+#endif // TRACE_H
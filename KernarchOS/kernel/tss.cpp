@@ -1,12 +1,20 @@
 #include "tss.h"
 #include "cstring.h"
+#include "percpu.h"
 
-TSS tss;
+TSS tss[MAX_CPUS];
 
 #define IO_PERMISSION_MAP_SIZE 8192 // Size in bytes for 8192 ports
 
 
 void init_tss() {
+    tss_init_cpu(0);
+}
+
+// Every CPU needs its own TSS, esp0 is the stack of the thread it runs
+void tss_init_cpu(uint32_t cpu) {
+    TSS& tss = ::tss[cpu];
+
     // Zero out the TSS
     memset(&tss, 0, sizeof(tss));
     
@@ -25,11 +33,11 @@ void init_tss() {
     tss.iomap_base = (uint32_t)(&tss.io_bitmap) - (uint32_t)(&tss); // Set the base address of the I/O permission map
      
      // Set up the TSS entry in the GDT
-    gdt_set_gate(5, base, limit, 0x89, 0x00);
+    gdt_set_gate(GDT_TSS_ENTRY(cpu), base, limit, 0x89, 0x00);
     // Load the TSS
-    asm volatile ("ltr %%ax" : : "a" (TSS_SEG));
+    asm volatile ("ltr %%ax" : : "a" (TSS_SEG_CPU(cpu)));
 }
 
 void tss_set_stack(uint32_t kesp) {
-    tss.esp0 = kesp;
+    tss[this_cpu()->id].esp0 = kesp;
 }
\ No newline at end of file
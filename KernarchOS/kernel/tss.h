@@ -35,9 +35,10 @@ struct TSS {
     uint8_t io_bitmap[8192]; // I/O permission bitmap
 } __attribute__((packed));
 
-extern TSS tss;
+extern TSS tss[MAX_CPUS];
 
 void init_tss();
+void tss_init_cpu(uint32_t cpu);
 
 void tss_set_stack(uint32_t kesp);
 
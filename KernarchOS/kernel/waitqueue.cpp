@@ -0,0 +1,103 @@
+#include "waitqueue.h"
+#include "process.h"
+#include "interrupts.h"
+
+void WaitQueue::sleep_locked(uint32_t flags, interrupt_frame* frame) {
+    PCB* self = current_process;
+
+    self->wq_next = nullptr;
+    self->wq_queued = true;
+    if (tail) tail->wq_next = self;
+    else head = self;
+    tail = self;
+
+    // Wakers dequeue under the lock and call wake_process before dropping
+    // it, so once wq_queued is clear the wakeup has fully happened
+    while (self->wq_queued) {
+        self->state = BLOCKED;
+        unlock_irqrestore(flags);
+        if (frame) schedule(frame);
+        else sys_schedule();
+        flags = lock_irqsave();
+    }
+    unlock_irqrestore(flags);
+}
+
+void WaitQueue::add_callback_locked(WaitCallback* callback) {
+    callback->next = nullptr;
+    if (callbacks_tail) callbacks_tail->next = callback;
+    else callbacks = callback;
+    callbacks_tail = callback;
+}
+
+// Offers the wake to each callback in turn until one takes it; those
+// that pass keep their place at the front
+bool WaitQueue::wake_callback_locked() {
+    WaitCallback* passed = nullptr;
+    WaitCallback* passed_tail = nullptr;
+    bool taken = false;
+
+    while (callbacks && !taken) {
+        WaitCallback* callback = callbacks;
+        callbacks = callback->next;
+        if (!callbacks) callbacks_tail = nullptr;
+        callback->next = nullptr;
+
+        taken = callback->func(callback);
+        if (taken) continue;
+        if (passed_tail) passed_tail->next = callback;
+        else passed = callback;
+        passed_tail = callback;
+    }
+
+    if (passed) {
+        passed_tail->next = callbacks;
+        if (!callbacks) callbacks_tail = passed_tail;
+        callbacks = passed;
+    }
+    return taken;
+}
+
+PCB* WaitQueue::wake_thread_locked() {
+    PCB* pcb = head;
+    if (!pcb) return nullptr;
+
+    head = pcb->wq_next;
+    if (!head) tail = nullptr;
+    pcb->wq_next = nullptr;
+    pcb->wq_queued = false;
+
+    wake_process(pcb);
+    return pcb;
+}
+
+bool WaitQueue::wake_one_locked() {
+    if (wake_thread_locked()) return true;
+    return wake_callback_locked();
+}
+
+bool WaitQueue::wake_one() {
+    uint32_t flags = lock_irqsave();
+    bool woken = wake_one_locked();
+    unlock_irqrestore(flags);
+    return woken;
+}
+
+uint32_t WaitQueue::wake_all() {
+    uint32_t flags = lock_irqsave();
+    uint32_t woken = 0;
+    while (wake_thread_locked()) woken++;
+
+    // Every callback gets the wake once, those that pass stay queued in order
+    WaitCallback* pending = callbacks;
+    callbacks = callbacks_tail = nullptr;
+    while (pending) {
+        WaitCallback* callback = pending;
+        pending = callback->next;
+        callback->next = nullptr;
+        if (callback->func(callback)) woken++;
+        else add_callback_locked(callback);
+    }
+    unlock_irqrestore(flags);
+    return woken;
+}
@@ -0,0 +1,74 @@
+#ifndef WAITQUEUE_H
+#define WAITQUEUE_H
+
+#include "types.h"
+#include "spinlock.h"
+#include "isr.h"
+
+struct PCB;
+
+// A waiter that is not a thread, such as a suspended coroutine: a wake
+// calls func, with the queue lock held, instead of waking a thread.
+// func returns true once it has taken the wake, and is then off the
+// queue; false leaves it queued in its place for the next wake.
+struct WaitCallback {
+    bool (*func)(WaitCallback* callback);
+    void* context;
+    WaitCallback* next;
+};
+
+// FIFO of BLOCKED threads waiting for an event. The waiter checks its
+// condition and goes to sleep under the queue lock, and wakers take the
+// same lock, so a wakeup between the check and the sleep is never lost.
+// Waiters must be threads, blocking through sys_schedule or, inside a
+// system call, through schedule on the syscall frame. Wakers may be
+// anything, interrupt handlers included. Callbacks are a second FIFO,
+// woken after the threads.
+class WaitQueue {
+public:
+    uint32_t lock_irqsave() { return lock.lock_irqsave(); }
+    void unlock_irqrestore(uint32_t flags) { lock.unlock_irqrestore(flags); }
+
+    // Caller holds the lock: blocks the calling thread until a wake takes
+    // it off the queue, and returns with the lock released. Pass the
+    // frame when called from a system call handler.
+    void sleep_locked(uint32_t flags, interrupt_frame* frame = nullptr);
+
+    // Sleeps until ready() holds, ready is evaluated under the lock
+    template<typename Cond>
+    void wait_until(Cond ready) {
+        uint32_t flags = lock_irqsave();
+        while (!ready()) {
+            sleep_locked(flags);
+            flags = lock_irqsave();
+        }
+        unlock_irqrestore(flags);
+    }
+
+    // Caller holds the lock
+    void add_callback_locked(WaitCallback* callback);
+
+    // Caller holds the lock; wakes the first thread, or else the first
+    // callback that takes the wake, and returns whether it woke anything
+    bool wake_one_locked();
+
+    // Caller holds the lock; wakes the first thread only and returns it,
+    // for handing something over that a callback could not take
+    PCB* wake_thread_locked();
+
+    bool wake_one();
+    uint32_t wake_all();
+
+    bool empty() const { return head == nullptr && callbacks == nullptr; }
+
+private:
+    bool wake_callback_locked();
+
+    TicketLock lock;
+    PCB* head;
+    PCB* tail;
+    WaitCallback* callbacks;
+    WaitCallback* callbacks_tail;
+};
+
+#endif // WAITQUEUE_H
@@ -0,0 +1,107 @@
+#include "workqueue.h"
+#include "process.h"
+#include "thread.h"
+#include "timer.h"
+#include "sleep_queue.h"
+#include "logger.h"
+
+WaitQueue WorkQueue::waiters;
+Work* WorkQueue::head;
+Work* WorkQueue::tail;
+Work* WorkQueue::delayed;
+volatile uint32_t WorkQueue::delayed_due = SLEEP_QUEUE_EMPTY;
+uint32_t WorkQueue::worker_count;
+volatile uint32_t WorkQueue::executed_count;
+
+void WorkQueue::start() {
+    uint32_t count = cpu_count < WORKQUEUE_WORKERS ? cpu_count : WORKQUEUE_WORKERS;
+    for (uint32_t i = 0; i < count; i++) {
+        Thread* thread = ThreadManager::create_thread(worker, nullptr, false);
+        if (!thread) {
+            Logger::log(LogLevel::ERROR, "Failed to create workqueue worker %d", i);
+            break;
+        }
+        wake_process(thread);
+        worker_count++;
+    }
+    Logger::log(LogLevel::INFO, "Workqueue started with %d workers", worker_count);
+}
+
+void WorkQueue::init(Work* work, WorkFunc func, void* context) {
+    work->func = func;
+    work->context = context;
+    work->next = nullptr;
+    work->due = 0;
+    work->pending = false;
+}
+
+// Caller holds the lock
+void WorkQueue::append(Work* work) {
+    work->next = nullptr;
+    if (tail) tail->next = work;
+    else head = work;
+    tail = work;
+    waiters.wake_one_locked();
+}
+
+bool WorkQueue::queue(Work* work) {
+    uint32_t flags = waiters.lock_irqsave();
+    bool queued = !work->pending;
+    if (queued) {
+        work->pending = true;
+        append(work);
+    }
+    waiters.unlock_irqrestore(flags);
+    return queued;
+}
+
+bool WorkQueue::queue_delayed(Work* work, uint32_t delay_ms) {
+    if (delay_ms == 0) return queue(work);
+
+    uint32_t flags = waiters.lock_irqsave();
+    bool queued = !work->pending;
+    if (queued) {
+        work->pending = true;
+        work->due = get_current_time_ms() + delay_ms;
+
+        Work** link = &delayed;
+        while (*link && (int32_t)((*link)->due - work->due) <= 0) link = &(*link)->next;
+        work->next = *link;
+        *link = work;
+        delayed_due = delayed->due;
+    }
+    waiters.unlock_irqrestore(flags);
+    return queued;
+}
+
+void WorkQueue::expire(uint32_t now) {
+    // Checked without the lock, the tick raises this on every CPU
+    uint32_t due = delayed_due;
+    if (due == SLEEP_QUEUE_EMPTY || (int32_t)(now - due) < 0) return;
+
+    uint32_t flags = waiters.lock_irqsave();
+    while (delayed && (int32_t)(now - delayed->due) >= 0) {
+        Work* work = delayed;
+        delayed = work->next;
+        append(work);
+    }
+    delayed_due = delayed ? delayed->due : SLEEP_QUEUE_EMPTY;
+    waiters.unlock_irqrestore(flags);
+}
+
+void WorkQueue::worker() {
+    while (true) {
+        Work* work = nullptr;
+        waiters.wait_until([&] {
+            work = head;
+            if (!work) return false;
+            head = work->next;
+            if (!head) tail = nullptr;
+            work->pending = false;
+            return true;
+        });
+
+        work->func(work);
+        __atomic_add_fetch(&executed_count, 1, __ATOMIC_RELAXED);
+    }
+}
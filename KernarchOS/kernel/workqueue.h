@@ -0,0 +1,61 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "types.h"
+#include "waitqueue.h"
+
+// Worker threads in the pool, never more than one per CPU
+#define WORKQUEUE_WORKERS 4
+
+struct Work;
+typedef void (*WorkFunc)(Work* work);
+
+// A deferred call. It is usually embedded in the object it works on; it
+// must stay valid until func has started running.
+struct Work {
+    WorkFunc func;
+    void* context;
+    Work* next;
+    uint32_t due;             // Delayed work only, in ms
+    volatile bool pending;    // Queued or delayed, queuing it again does nothing
+};
+
+// Deferred work run by a pool of kernel worker threads. Interrupt
+// handlers queue the slow part of their job here and return; the workers
+// run it preemptibly with interrupts on. Work is picked in FIFO order,
+// and at most one item runs per worker.
+class WorkQueue {
+public:
+    // Starts the workers; work queued before then waits for them
+    static void start();
+
+    static void init(Work* work, WorkFunc func, void* context = nullptr);
+
+    // Safe from interrupt handlers; false if the work was already pending.
+    // The work is no longer pending once func starts, so it may requeue itself.
+    static bool queue(Work* work);
+    static bool queue_delayed(Work* work, uint32_t delay_ms);
+
+    // From the timer softirq: queues delayed work whose time has come
+    static void expire(uint32_t now);
+    // Earliest delayed work, SLEEP_QUEUE_EMPTY if there is none; the
+    // timer interrupt fires for it and raises SOFTIRQ_TIMER
+    static uint32_t next_due() { return delayed_due; }
+
+    static uint32_t workers() { return worker_count; }
+    static uint32_t executed() { return executed_count; }
+
+private:
+    static void worker();
+    static void append(Work* work);
+
+    static WaitQueue waiters;          // Its lock guards both lists
+    static Work* head;
+    static Work* tail;
+    static Work* delayed;              // Sorted by due time
+    static volatile uint32_t delayed_due;
+    static uint32_t worker_count;
+    static volatile uint32_t executed_count;
+};
+
+#endif // WORKQUEUE_H
@@ -0,0 +1,10 @@
+#ifndef HOST_H
+#define HOST_H
+
+// Kernel headers built with the host compiler. The host's own integer
+// types stand in for types.h, whose 32-bit size_t would clash with them.
+#include <stdint.h>
+#include <stddef.h>
+#define KERNARCHOS_TYPES_H
+
+#endif // HOST_H
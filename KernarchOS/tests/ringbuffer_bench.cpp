@@ -0,0 +1,68 @@
+// Host benchmark for kernel/ringbuffer.h, the host side of ringbench:
+// make bench
+#include "host.h"
+#include "../kernel/ringbuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define BENCH_RING_SIZE 1024
+
+static SpscRing<uint32_t, BENCH_RING_SIZE> spsc;
+static MpscRing<uint32_t, BENCH_RING_SIZE> mpsc;
+static MpmcRing<uint32_t, BENCH_RING_SIZE> mpmc;
+
+// Producers push items each, consumers split the total between them;
+// returns nanoseconds per item. A thread yields when the ring is full or
+// empty, as spinning would only burn its peer's slice on one CPU.
+template<typename Ring>
+static double run(Ring& ring, uint32_t producers, uint32_t consumers, uint32_t batch, uint32_t items) {
+    uint32_t total = producers * items;
+    uint32_t received = 0;
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&ring, batch, items] {
+            std::vector<uint32_t> values(batch);
+            for (uint32_t sent = 0; sent < items;) {
+                uint32_t count = items - sent < batch ? items - sent : batch;
+                for (uint32_t i = 0; i < count; i++) values[i] = sent + i;
+                uint32_t pushed = ring.push_batch(values.data(), count);
+                if (!pushed) std::this_thread::yield();
+                sent += pushed;
+            }
+        });
+    }
+    for (uint32_t c = 0; c < consumers; c++) {
+        threads.emplace_back([&ring, &received, batch, total] {
+            std::vector<uint32_t> values(batch);
+            while (__atomic_load_n(&received, __ATOMIC_RELAXED) < total) {
+                uint32_t count = ring.pop_batch(values.data(), batch);
+                if (count) __atomic_add_fetch(&received, count, __ATOMIC_RELAXED);
+                else std::this_thread::yield();
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / total;
+}
+
+int main(int argc, char** argv) {
+    uint32_t items = argc > 1 ? (uint32_t)atoi(argv[1]) : 0;
+    if (items == 0) items = 10000000;
+
+    printf("%-6s %-10s %-6s %s\n", "ring", "threads", "batch", "ns/item");
+    printf("%-6s %-10s %-6u %.2f\n", "spsc", "1p/1c", 1, run(spsc, 1, 1, 1, items));
+    printf("%-6s %-10s %-6u %.2f\n", "spsc", "1p/1c", 32, run(spsc, 1, 1, 32, items));
+    printf("%-6s %-10s %-6u %.2f\n", "mpsc", "1p/1c", 1, run(mpsc, 1, 1, 1, items));
+    printf("%-6s %-10s %-6u %.2f\n", "mpsc", "4p/1c", 32, run(mpsc, 4, 1, 32, items / 4));
+    printf("%-6s %-10s %-6u %.2f\n", "mpmc", "1p/1c", 1, run(mpmc, 1, 1, 1, items));
+    printf("%-6s %-10s %-6u %.2f\n", "mpmc", "4p/4c", 32, run(mpmc, 4, 4, 32, items / 4));
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Host tests for kernel/ringbuffer.h: make test
+#include "host.h"
+#include "../kernel/ringbuffer.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// Rings are zero-initialised in the kernel, globals here do the same
+static SpscRing<uint32_t, 8> spsc_small;
+static MpscRing<uint32_t, 8> mpsc_small;
+static MpmcRing<uint32_t, 8> mpmc_small;
+
+// Full, empty and wrap-around, for any ring with push/pop/batches
+template<typename Ring>
+static void test_single_thread(Ring& ring) {
+    uint32_t value = 0;
+    CHECK(ring.empty());
+    CHECK(!ring.pop(&value));
+
+    for (uint32_t i = 0; i < Ring::capacity(); i++) CHECK(ring.push(i));
+    CHECK(!ring.push(99));
+    CHECK(ring.size() == Ring::capacity());
+
+    for (uint32_t i = 0; i < Ring::capacity(); i++) {
+        CHECK(ring.pop(&value));
+        CHECK(value == i);
+    }
+    CHECK(!ring.pop(&value));
+    CHECK(ring.empty());
+
+    // Batches of 3 against 8 slots land on every offset and wrap
+    uint32_t next_in = 0, next_out = 0;
+    for (uint32_t round = 0; round < 100; round++) {
+        uint32_t in[3] = { next_in, next_in + 1, next_in + 2 };
+        uint32_t pushed = ring.push_batch(in, 3);
+        CHECK(pushed == 3);
+        next_in += pushed;
+
+        uint32_t out[3] = {};
+        uint32_t popped = ring.pop_batch(out, 3);
+        CHECK(popped == 3);
+        for (uint32_t i = 0; i < popped; i++) CHECK(out[i] == next_out + i);
+        next_out += popped;
+    }
+
+    // A batch larger than the free space is cut short, and so is a pop
+    // larger than what is queued
+    uint32_t many[12];
+    for (uint32_t i = 0; i < 12; i++) many[i] = i;
+    CHECK(ring.push_batch(many, 5) == 5);
+    CHECK(ring.push_batch(many + 5, 7) == Ring::capacity() - 5);
+    uint32_t out[12] = {};
+    CHECK(ring.pop_batch(out, 12) == Ring::capacity());
+    for (uint32_t i = 0; i < Ring::capacity(); i++) CHECK(out[i] == i);
+    CHECK(ring.pop_batch(out, 12) == 0);
+    CHECK(ring.empty());
+}
+
+// The indices are free-running: push more than 2^32 elements through
+// an SPSC ring, so both counters overflow, and check it still works
+static void test_spsc_counter_wrap() {
+    static SpscRing<uint8_t, 4096> ring;
+    static uint8_t in[4096], out[4096];
+    uint64_t moved = 0;
+    uint8_t expected = 0;
+
+    while (moved < (1ull << 32) + 3 * 4096) {
+        for (uint32_t i = 0; i < 4096; i++) in[i] = (uint8_t)(expected + i);
+        uint32_t pushed = ring.push_batch(in, 4096);
+        uint32_t popped = ring.pop_batch(out, 4096);
+        if (pushed != 4096 || popped != 4096 || out[0] != expected || out[4095] != (uint8_t)(expected + 4095)) {
+            CHECK(false);
+            return;
+        }
+        expected = (uint8_t)(expected + 4096);
+        moved += 4096;
+    }
+    CHECK(ring.empty());
+    CHECK(ring.push(7));
+    uint8_t value = 0;
+    CHECK(ring.pop(&value) && value == 7);
+}
+
+// The MPMC and MPSC counters start anywhere once the slot turns agree,
+// so start them just short of 2^32
+template<typename Ring>
+struct Wrapped : Ring {
+    void start_at(uint32_t pos) {
+        this->enqueue_pos = this->dequeue_pos = pos;
+        for (uint32_t i = 0; i < Ring::capacity(); i++) this->slots[i].turn = pos;
+    }
+};
+
+template<typename Ring>
+static void test_counter_wrap(Wrapped<Ring>& ring) {
+    ring.start_at(0u - 3 * Ring::capacity());
+    uint32_t next_in = 0, next_out = 0;
+    for (uint32_t round = 0; round < 10 * Ring::capacity(); round++) {
+        uint32_t in[3] = { next_in, next_in + 1, next_in + 2 };
+        next_in += ring.push_batch(in, 3);
+        uint32_t out[3] = {};
+        uint32_t popped = ring.pop_batch(out, 3);
+        CHECK(popped == 3);
+        for (uint32_t i = 0; i < popped; i++) CHECK(out[i] == next_out + i);
+        next_out += popped;
+    }
+    CHECK(ring.empty());
+}
+
+static Wrapped<MpscRing<uint32_t, 8>> mpsc_wrapped;
+static Wrapped<MpmcRing<uint32_t, 8>> mpmc_wrapped;
+
+// Threads yield whenever the ring is full or empty, so these also
+// finish quickly on a single CPU
+#define THREAD_ITEMS 1000000
+#define THREAD_PRODUCERS 4
+#define THREAD_CONSUMERS 4
+
+// Values carry their producer in the top byte
+static uint32_t tag(uint32_t producer, uint32_t seq) { return (producer << 24) | seq; }
+
+// One producer, one consumer, in batches: everything arrives in order
+static void test_spsc_threads() {
+    static SpscRing<uint32_t, 64> ring;
+    std::thread producer([] {
+        uint32_t values[7];
+        for (uint32_t sent = 0; sent < THREAD_ITEMS;) {
+            uint32_t count = THREAD_ITEMS - sent < 7 ? THREAD_ITEMS - sent : 7;
+            for (uint32_t i = 0; i < count; i++) values[i] = sent + i;
+            uint32_t pushed = ring.push_batch(values, count);
+            if (!pushed) std::this_thread::yield();
+            sent += pushed;
+        }
+    });
+
+    uint32_t values[5], expected = 0;
+    bool ordered = true;
+    while (expected < THREAD_ITEMS) {
+        uint32_t count = ring.pop_batch(values, 5);
+        if (!count) std::this_thread::yield();
+        for (uint32_t i = 0; i < count; i++) ordered &= values[i] == expected + i;
+        expected += count;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(ring.empty());
+}
+
+// Several producers, one consumer: each producer's values arrive in order
+static void test_mpsc_threads() {
+    static MpscRing<uint32_t, 64> ring;
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < THREAD_PRODUCERS; p++) {
+        producers.emplace_back([p] {
+            for (uint32_t i = 0; i < THREAD_ITEMS;) {
+                if (ring.push(tag(p, i))) i++;
+                else std::this_thread::yield();
+            }
+        });
+    }
+
+    uint32_t next[THREAD_PRODUCERS] = {};
+    uint32_t values[16];
+    bool ordered = true;
+    for (uint32_t received = 0; received < THREAD_PRODUCERS * THREAD_ITEMS;) {
+        uint32_t count = ring.pop_batch(values, 16);
+        if (!count) std::this_thread::yield();
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t p = values[i] >> 24;
+            ordered &= p < THREAD_PRODUCERS && (values[i] & 0xFFFFFF) == next[p];
+            if (p < THREAD_PRODUCERS) next[p]++;
+        }
+        received += count;
+    }
+    for (std::thread& producer : producers) producer.join();
+    CHECK(ordered);
+    for (uint32_t p = 0; p < THREAD_PRODUCERS; p++) CHECK(next[p] == THREAD_ITEMS);
+    CHECK(ring.empty());
+}
+
+// Several of each: every value arrives exactly once
+static void test_mpmc_threads() {
+    static MpmcRing<uint32_t, 64> ring;
+    static std::vector<uint8_t> seen(THREAD_PRODUCERS * THREAD_ITEMS);
+    static uint32_t received;
+
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < THREAD_PRODUCERS; p++) {
+        threads.emplace_back([p] {
+            for (uint32_t i = 0; i < THREAD_ITEMS;) {
+                if (ring.push(tag(p, i))) i++;
+                else std::this_thread::yield();
+            }
+        });
+    }
+    for (uint32_t c = 0; c < THREAD_CONSUMERS; c++) {
+        threads.emplace_back([] {
+            uint32_t values[16];
+            while (__atomic_load_n(&received, __ATOMIC_RELAXED) < THREAD_PRODUCERS * THREAD_ITEMS) {
+                uint32_t count = ring.pop_batch(values, 16);
+                if (!count) std::this_thread::yield();
+                for (uint32_t i = 0; i < count; i++) {
+                    uint32_t index = (values[i] >> 24) * THREAD_ITEMS + (values[i] & 0xFFFFFF);
+                    if (index < seen.size()) __atomic_add_fetch(&seen[index], 1, __ATOMIC_RELAXED);
+                }
+                __atomic_add_fetch(&received, count, __ATOMIC_RELAXED);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    uint32_t once = 0;
+    for (uint8_t count : seen) once += count == 1;
+    CHECK(once == THREAD_PRODUCERS * THREAD_ITEMS);
+    CHECK(received == THREAD_PRODUCERS * THREAD_ITEMS);
+    CHECK(ring.empty());
+}
+
+int main() {
+    test_single_thread(spsc_small);
+    test_single_thread(mpsc_small);
+    test_single_thread(mpmc_small);
+    test_spsc_counter_wrap();
+    test_counter_wrap(mpsc_wrapped);
+    test_counter_wrap(mpmc_wrapped);
+    test_spsc_threads();
+    test_mpsc_threads();
+    test_mpmc_threads();
+
+    if (failures) {
+        printf("ringbuffer: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("ringbuffer: all checks passed\n");
+    return 0;
+}